@@ -852,6 +852,74 @@ SRST
     Show SEV information.
 ERST
 
+#if defined(TARGET_ARM)
+    {
+        .name       = "tegra-trace",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show Tegra trace state",
+        .cmd        = hmp_info_tegra_trace,
+    },
+#endif
+
+SRST
+  ``info tegra-trace``
+    Show the Tegra trace viewer connection and enabled event classes.
+ERST
+
+#if defined(TARGET_ARM)
+    {
+        .name       = "tegra-mmio",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show Tegra MMIO access statistics "
+                      "(-r: reset them afterwards)",
+        .cmd        = hmp_info_tegra_mmio,
+    },
+#endif
+
+SRST
+  ``info tegra-mmio [-r]``
+    Show MMIO access counts and handler latency of the Tegra devices,
+    together with their most accessed registers.  ``-r`` resets the
+    statistics afterwards.
+ERST
+
+#if defined(TARGET_ARM)
+    {
+        .name       = "tegra-cdma",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show Tegra host1x channel counters "
+                      "(-r: reset them afterwards)",
+        .cmd        = hmp_info_tegra_cdma,
+    },
+#endif
+
+SRST
+  ``info tegra-cdma [-r]``
+    Show per channel host1x command DMA counters: decoded words, gathers
+    and opcodes, time blocked on syncpoints and module locks and BQL hold
+    time.  ``-r`` resets the counters afterwards.
+ERST
+
+#if defined(TARGET_ARM)
+    {
+        .name       = "tegra-cpu-idle",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show Tegra CPU WFE idle counters "
+                      "(-r: reset them afterwards)",
+        .cmd        = hmp_info_tegra_cpu_idle,
+    },
+#endif
+
+SRST
+  ``info tegra-cpu-idle [-r]``
+    Show per core WFE counters: WFEs executed, times the core was parked
+    and what woke it up.  ``-r`` resets the counters afterwards.
+ERST
+
     {
         .name       = "replay",
         .args_type  = "",
@@ -285,6 +285,38 @@ SRST
   changes status of a trace event
 ERST
 
+#if defined(TARGET_ARM)
+    {
+        .name       = "tegra-trace-set",
+        .args_type  = "events:s,option:b,device:l?",
+        .params     = "events on|off [device]",
+        .help       = "changes status of Tegra trace event classes "
+                      "(events: comma separated rw,irq,text,cdma or all; "
+                      "device: base address, default is all)",
+        .cmd        = hmp_tegra_trace_set,
+    },
+
+SRST
+``tegra-trace-set`` *events* on|off [*device*]
+  Enable or disable Tegra trace event classes, optionally for a single
+  device identified by its base address.
+ERST
+
+    {
+        .name       = "tegra-trace-record",
+        .args_type  = "option:b,file:F?",
+        .params     = "on|off [file]",
+        .help       = "start or stop recording Tegra trace to a file",
+        .cmd        = hmp_tegra_trace_record,
+    },
+
+SRST
+``tegra-trace-record`` on|off [*file*]
+  Start or stop recording the enabled Tegra trace events to an indexed
+  file, see ``scripts/tegra-trace.py``.
+ERST
+#endif
+
 #if defined(CONFIG_TRACE_SIMPLE)
     {
         .name       = "trace-file",
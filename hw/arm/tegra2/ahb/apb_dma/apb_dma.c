@@ -1131,8 +1131,8 @@ static void tegra_apb_dma_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_apb_dma *s = TEGRA_APB_DMA(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_apb_dma_mem_ops, s,
-                          "tegra.apb_dma", 0x1200);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_apb_dma_mem_ops, s,
+                       "tegra.apb_dma", 0x1200);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
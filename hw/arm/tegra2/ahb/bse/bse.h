@@ -230,6 +230,29 @@ typedef union secure_sec_sel_u {
 
 #define DEFINE_REG32(reg) reg##_t reg
 
+/* CMD_BLKSTARTENGINE job.  */
+typedef struct tegra_bse_job {
+    struct tegra_bse_state *s;
+    dma_addr_t src;
+    dma_addr_t dst;
+    dma_addr_t len;
+    dma_addr_t len_in;
+    dma_addr_t len_out;
+    void *in;
+    void *out;
+    uint8_t key[32];
+    uint32_t key_gen;
+    int slot;
+    int key_len;
+    bool cbc;
+    bool enc;
+    bool hash;
+    bool hash_dest;
+    bool rng;
+    uint8_t mac[16];
+    QSIMPLEQ_ENTRY(tegra_bse_job) next;
+} tegra_bse_job;
+
 typedef struct tegra_bse_state {
     SysBusDevice parent_obj;
 
@@ -238,6 +261,10 @@ typedef struct tegra_bse_state {
     uint32_t state;
     uint8_t aes_key[SLOTS_MAX_NB][32];
     uint8_t aes_iv[SLOTS_MAX_NB][AES_BLOCK_SIZE];
+    struct QCryptoCipher *aes_cipher[SLOTS_MAX_NB][2];  /* ECB, CBC */
+    uint32_t aes_cipher_gen[SLOTS_MAX_NB][2];
+    uint32_t aes_key_gen[SLOTS_MAX_NB];
+    QSIMPLEQ_HEAD(, tegra_bse_job) jobs;    /* Head is in flight */
     uint32_t src_addr;
     bool has_key_sched_gen;
     uint8_t hw_key_sched_length;
@@ -255,4 +282,9 @@ typedef struct tegra_bse_state {
     DEFINE_REG32(secure_sec_sel)[SLOTS_MAX_NB];
 } tegra_bse;
 
+void tegra_bse_aes_init(tegra_bse *s);
+void tegra_bse_aes_submit(tegra_bse *s, tegra_bse_job *job);
+void tegra_bse_aes_key_changed(tegra_bse *s, int slot);
+void tegra_bse_aes_reset(tegra_bse *s);
+
 #endif // TEGRA_BSE_H
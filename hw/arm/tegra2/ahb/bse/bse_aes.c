@@ -0,0 +1,398 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * AES of the BSEA/BSEV engines on top of the QEMU crypto layer.  Expanded
+ * keys live in the cipher objects, cached per key slot and mode until the
+ * slot gets a new key loaded.
+ *
+ * The hash mode is AES CBC-MAC into the HASH_RESULT registers, guests
+ * build CMAC on it by applying the subkeys to the last block themselves.
+ * Input is streamed from the mapped guest buffer, nothing gets written
+ * back unless HASH_DEST is set.  The RNG mode fills the output from the
+ * host random generator.
+ *
+ * CMD_BLKSTARTENGINE only queues a job, jobs of an engine run one by one
+ * on the thread pool and complete in a bottom half that raises the IRQ.
+ * The job carries a copy of the key, the cipher cache and the slot IVs are
+ * touched by the running job only.  The queue is drained when the VM stops,
+ * so that the slot IVs and the engine state are settled for migration.
+ */
+
+#include "tegra_common.h"
+
+#include "block/aio-wait.h"
+#include "block/thread-pool.h"
+#include "crypto/aes.h"
+#include "crypto/cipher.h"
+#include "hw/sysbus.h"
+#include "qapi/error.h"
+#include "qemu/guest-random.h"
+#include "qemu/main-loop.h"
+#include "sysemu/dma.h"
+#include "sysemu/runstate.h"
+
+#include "devices.h"
+#include "tegra_trace.h"
+
+#include "bse.h"
+
+#define TEGRA_BSE_HASH_CHUNK    4096
+
+/* Queued jobs of both engines.  */
+static unsigned int tegra_bse_nr_jobs;
+
+static QCryptoCipherAlgorithm tegra_bse_aes_alg(int key_len)
+{
+    switch (key_len) {
+    case 128:
+        return QCRYPTO_CIPHER_ALG_AES_128;
+    case 192:
+        return QCRYPTO_CIPHER_ALG_AES_192;
+    case 256:
+        return QCRYPTO_CIPHER_ALG_AES_256;
+    }
+
+    return QCRYPTO_CIPHER_ALG__MAX;
+}
+
+static QCryptoCipher *tegra_bse_aes_cipher(tegra_bse *s, tegra_bse_job *job)
+{
+    QCryptoCipherAlgorithm alg = tegra_bse_aes_alg(job->key_len);
+    QCryptoCipher **cipher = &s->aes_cipher[job->slot][job->cbc];
+    uint32_t *gen = &s->aes_cipher_gen[job->slot][job->cbc];
+    Error *err = NULL;
+
+    if (alg == QCRYPTO_CIPHER_ALG__MAX) {
+        TPRINT("%s: bad key_len=%d\n", __func__, job->key_len);
+        return NULL;
+    }
+
+    if (*cipher && (*cipher)->alg == alg && *gen == job->key_gen)
+        return *cipher;
+
+    qcrypto_cipher_free(*cipher);
+
+    *cipher = qcrypto_cipher_new(alg, job->cbc ? QCRYPTO_CIPHER_MODE_CBC :
+                                                 QCRYPTO_CIPHER_MODE_ECB,
+                                 job->key, job->key_len / 8, &err);
+    *gen = job->key_gen;
+
+    if (!*cipher) {
+        TPRINT("%s: %s\n", __func__, error_get_pretty(err));
+        error_free(err);
+    }
+
+    return *cipher;
+}
+
+static void tegra_bse_dump(tegra_bse *s, const char *what,
+                           const uint8_t *buf, int blocks)
+{
+    int i;
+
+    if (!tegra_trace_event_enabled(TEGRA_TRACE_EV_TXT))
+        return;
+
+    TPRINT("%s: ----------- %s ----------\n",
+           memory_region_name(&s->iomem), what);
+
+    for (i = 0; i < blocks * AES_BLOCK_SIZE; i++)
+        TPRINT("0x%02X,%s", buf[i],
+               ((i + 1) % 16 == 0 || i == blocks * AES_BLOCK_SIZE - 1) ?
+                                                                "\n" : " ");
+}
+
+/*
+ * En/decrypts whole blocks, CBC chains from and updates the slot IV.  In
+ * and out may be the same buffer.
+ */
+static bool tegra_bse_aes_crypt(tegra_bse *s, tegra_bse_job *job,
+                                const uint8_t *in, uint8_t *out, size_t len)
+{
+    QCryptoCipher *cipher = tegra_bse_aes_cipher(s, job);
+    uint8_t *iv = s->aes_iv[job->slot];
+    uint8_t next_iv[AES_BLOCK_SIZE];
+    int ret;
+
+    if (!cipher || !len || len % AES_BLOCK_SIZE)
+        return false;
+
+    if (job->cbc) {
+        tegra_bse_dump(s, "IV", iv, 1);
+
+        if (qcrypto_cipher_setiv(cipher, iv, AES_BLOCK_SIZE, NULL) < 0)
+            return false;
+
+        /* Input is overwritten by in-place decryption.  */
+        if (!job->enc)
+            memcpy(next_iv, in + len - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    }
+
+    tegra_bse_dump(s, job->enc ? "IN CLEARTEXT" : "IN CIPHER", in,
+                   len / AES_BLOCK_SIZE);
+
+    if (job->enc)
+        ret = qcrypto_cipher_encrypt(cipher, in, out, len, NULL);
+    else
+        ret = qcrypto_cipher_decrypt(cipher, in, out, len, NULL);
+
+    if (ret < 0)
+        return false;
+
+    tegra_bse_dump(s, job->enc ? "OUT CIPHER" : "OUT CLEARTEXT", out,
+                   len / AES_BLOCK_SIZE);
+
+    if (job->cbc)
+        memcpy(iv, job->enc ? out + len - AES_BLOCK_SIZE : next_iv,
+               AES_BLOCK_SIZE);
+
+    return true;
+}
+
+/* CBC-MAC of the input, chained through the slot IV.  */
+static bool tegra_bse_aes_hash(tegra_bse *s, tegra_bse_job *job,
+                               const uint8_t *in, size_t len)
+{
+    QCryptoCipher *cipher = tegra_bse_aes_cipher(s, job);
+    uint8_t *iv = s->aes_iv[job->slot];
+    uint8_t buf[TEGRA_BSE_HASH_CHUNK];
+    size_t chunk;
+
+    if (!cipher || !len || len % AES_BLOCK_SIZE)
+        return false;
+
+    tegra_bse_dump(s, "IV", iv, 1);
+
+    for (; len; in += chunk, len -= chunk) {
+        chunk = MIN(len, sizeof(buf));
+
+        if (qcrypto_cipher_setiv(cipher, iv, AES_BLOCK_SIZE, NULL) < 0)
+            return false;
+
+        if (qcrypto_cipher_encrypt(cipher, in, buf, chunk, NULL) < 0)
+            return false;
+
+        memcpy(iv, buf + chunk - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    }
+
+    memcpy(job->mac, iv, AES_BLOCK_SIZE);
+    tegra_bse_dump(s, "HASH", job->mac, 1);
+
+    return true;
+}
+
+/* Runs on a thread pool worker without the BQL.  */
+static int tegra_bse_job_work(void *opaque)
+{
+    tegra_bse_job *job = opaque;
+    bool ok;
+
+    if (job->rng) {
+        qemu_guest_getrandom_nofail(job->out, job->len_out);
+        return 0;
+    }
+
+    if (job->hash)
+        ok = tegra_bse_aes_hash(job->s, job, job->in, job->len_in);
+    else
+        ok = tegra_bse_aes_crypt(job->s, job, job->in, job->out,
+                                 MIN(job->len_in, job->len_out));
+
+    return ok ? 0 : -EINVAL;
+}
+
+/* Unmaps the buffers of the queue head, drops it and raises the IRQ.  */
+static void tegra_bse_job_finish(tegra_bse_job *job, int ret)
+{
+    tegra_bse *s = job->s;
+    int i;
+
+    if (ret < 0)
+        TPRINT("%s: %s %s failed\n", __func__, memory_region_name(&s->iomem),
+               job->hash ? "hash" : job->cbc ? "CBC" : "ECB");
+
+    if (job->in)
+        dma_memory_unmap(&address_space_memory, job->in, job->len_in,
+                         DMA_DIRECTION_TO_DEVICE, job->len_in);
+    if (job->out)
+        dma_memory_unmap(&address_space_memory, job->out, job->len_out,
+                         DMA_DIRECTION_FROM_DEVICE, job->len_out);
+
+    if (job->hash && ret == 0) {
+        for (i = 0; i < 4; i++)
+            s->secure_hash_result[i].reg32 = ldl_le_p(job->mac + i * 4);
+
+        if (job->hash_dest)
+            dma_memory_write(&address_space_memory, job->dst, job->mac,
+                             AES_BLOCK_SIZE);
+    }
+
+    QSIMPLEQ_REMOVE_HEAD(&s->jobs, next);
+    qatomic_dec(&tegra_bse_nr_jobs);
+    g_free(job);
+
+    if (QSIMPLEQ_EMPTY(&s->jobs)) {
+        s->intr_status.engine_busy = 0;
+        s->intr_status.icq_empty = 1;
+    }
+
+    TRACE_IRQ_RAISE(s->iomem.addr, s->irq);
+}
+
+static bool tegra_bse_job_map(tegra_bse_job *job)
+{
+    job->len_in = job->len_out = job->len;
+
+    if (!job->rng) {
+        job->in = dma_memory_map(&address_space_memory, job->src,
+                                 &job->len_in, DMA_DIRECTION_TO_DEVICE);
+        if (!job->in)
+            return false;
+    }
+
+    if (!job->hash) {
+        job->out = dma_memory_map(&address_space_memory, job->dst,
+                                  &job->len_out, DMA_DIRECTION_FROM_DEVICE);
+        if (!job->out)
+            return false;
+    }
+
+    return true;
+}
+
+static void tegra_bse_job_done(void *opaque, int ret);
+
+/*
+ * Maps the buffers of the job at the queue head and hands it to a worker.
+ * Jobs pointing outside of RAM or at a key slot that doesn't exist fail
+ * right away, like the engine faulting on the bus.
+ */
+static void tegra_bse_job_start(tegra_bse *s)
+{
+    tegra_bse_job *job;
+
+    while ((job = QSIMPLEQ_FIRST(&s->jobs))) {
+        if (!job->rng && job->slot >= SLOTS_MAX_NB) {
+            TPRINT("%s: %s bad key slot %d\n", __func__,
+                   memory_region_name(&s->iomem), job->slot);
+
+            tegra_bse_job_finish(job, -EINVAL);
+            continue;
+        }
+
+        if (tegra_bse_job_map(job)) {
+            thread_pool_submit_aio(aio_get_thread_pool(qemu_get_aio_context()),
+                                   tegra_bse_job_work, job,
+                                   tegra_bse_job_done, job);
+            return;
+        }
+
+        TPRINT("%s: %s bad DMA src=0x%08" PRIX64 " dst=0x%08" PRIX64
+               " len=0x%" PRIX64 "\n", __func__,
+               memory_region_name(&s->iomem), (uint64_t) job->src,
+               (uint64_t) job->dst, (uint64_t) job->len);
+
+        tegra_bse_job_finish(job, -EFAULT);
+    }
+}
+
+static void tegra_bse_job_done(void *opaque, int ret)
+{
+    tegra_bse_job *job = opaque;
+    tegra_bse *s = job->s;
+
+    tegra_bse_job_finish(job, ret);
+    tegra_bse_job_start(s);
+}
+
+/* Queues a CMD_BLKSTARTENGINE job, the engine is busy until it completes.  */
+void tegra_bse_aes_submit(tegra_bse *s, tegra_bse_job *job)
+{
+    bool idle = QSIMPLEQ_EMPTY(&s->jobs);
+
+    job->s = s;
+
+    /* KEY_INDEX has room for 32 slots, jobs using the others fail.  */
+    if (job->slot < SLOTS_MAX_NB) {
+        memcpy(job->key, s->aes_key[job->slot], sizeof(job->key));
+        job->key_gen = s->aes_key_gen[job->slot];
+    }
+
+    s->intr_status.engine_busy = 1;
+    s->intr_status.icq_empty = 0;
+
+    QSIMPLEQ_INSERT_TAIL(&s->jobs, job, next);
+    qatomic_inc(&tegra_bse_nr_jobs);
+
+    if (idle)
+        tegra_bse_job_start(s);
+}
+
+/* Whether any engine has a job queued, used by the idle warp.  */
+bool tegra_bse_busy(void)
+{
+    return qatomic_read(&tegra_bse_nr_jobs) != 0;
+}
+
+/* Invalidates the expanded keys of the slot, called on a key load.  */
+void tegra_bse_aes_key_changed(tegra_bse *s, int slot)
+{
+    s->aes_key_gen[slot]++;
+}
+
+/* Drops the queued jobs and waits for the running one, on reset.  */
+void tegra_bse_aes_reset(tegra_bse *s)
+{
+    tegra_bse_job *job = QSIMPLEQ_FIRST(&s->jobs), *queued;
+    int i, mode;
+
+    if (job) {
+        while ((queued = QSIMPLEQ_NEXT(job, next))) {
+            QSIMPLEQ_REMOVE(&s->jobs, queued, tegra_bse_job, next);
+            qatomic_dec(&tegra_bse_nr_jobs);
+            g_free(queued);
+        }
+
+        AIO_WAIT_WHILE(qemu_get_aio_context(), !QSIMPLEQ_EMPTY(&s->jobs));
+    }
+
+    for (i = 0; i < SLOTS_MAX_NB; i++) {
+        for (mode = 0; mode < 2; mode++) {
+            qcrypto_cipher_free(s->aes_cipher[i][mode]);
+            s->aes_cipher[i][mode] = NULL;
+        }
+    }
+}
+
+static void tegra_bse_aes_vm_state_change(void *opaque, bool running,
+                                          RunState state)
+{
+    tegra_bse *s = opaque;
+
+    /* Jobs aren't migrated, let them complete while the VM is stopped.  */
+    if (!running)
+        AIO_WAIT_WHILE(qemu_get_aio_context(), !QSIMPLEQ_EMPTY(&s->jobs));
+}
+
+void tegra_bse_aes_init(tegra_bse *s)
+{
+    QSIMPLEQ_INIT(&s->jobs);
+    qemu_add_vm_change_state_handler(tegra_bse_aes_vm_state_change, s);
+}
@@ -22,6 +22,7 @@
 #include "hw/sysbus.h"
 
 #include "clk_rst.h"
+#include "mmio_window.h"
 #include "remote_io.h"
 #include "tegra_trace.h"
 
@@ -32,6 +33,7 @@ typedef struct bse_remote_state {
     SysBusDevice parent_obj;
 
     MemoryRegion iomem;
+    tegra_mmio_windows windows;
     qemu_irq irq_ucq_error;
     qemu_irq irq_sync_token;
     qemu_irq irq_bse_v;
@@ -39,72 +41,48 @@ typedef struct bse_remote_state {
     qemu_irq irq_sxe;
 } bse_remote;
 
+static const tegra_mmio_window bse_remote_windows[] = {
+    { 0x0000, 0x100, 0x60010000 },  /* UCQ */
+    { 0xA000, 0x1000, 0x6001A000 }, /* SXE */
+    { 0xB000, 0x1000, 0x6001B000 }, /* BSEV */
+    { 0xC000, 0x100, 0x6001C000 },  /* MBE */
+    { 0xC200, 0x100, 0x6001C200 },  /* PPE */
+    { 0xC400, 0x100, 0x6001C400 },  /* MCE */
+    { 0xC600, 0x100, 0x6001C600 },  /* TFE */
+    { 0xC800, 0x100, 0x6001C800 },  /* PPB */
+    { 0xCA00, 0x100, 0x6001CA00 },  /* VDMA */
+    { 0xCC00, 0x100, 0x6001CC00 },  /* UCQ2 */
+    { 0xD000, 0x800, 0x6001D000 },  /* BSEA2 */
+    { 0xD800, 0x300, 0x6001D800 },  /* FRAMEID */
+};
+
+static void bse_remote_trace(bse_remote *s, hwaddr offset, uint32_t value,
+                             int is_write)
+{
+    const tegra_mmio_window *win = tegra_mmio_window_find(&s->windows, offset);
+    int rst_set = tegra_rst_asserted(TEGRA20_CLK_VDE);
+    int clk_en = tegra_clk_enabled(TEGRA20_CLK_VDE);
+    uint32_t base = s->iomem.addr;
+
+    if (win) {
+        base = win->base;
+        offset -= win->start;
+    }
+
+    if (is_write)
+        TRACE_WRITE_EXT(base, offset, value, value, !clk_en, rst_set);
+    else
+        TRACE_READ_EXT(base, offset, value, !clk_en, rst_set);
+}
+
 static uint64_t bse_remote_read(void *opaque, hwaddr offset,
                                  unsigned size)
 {
     bse_remote *s = opaque;
     uint32_t ret = remote_io_read(s->iomem.addr + offset, size << 3);
-    int rst_set = tegra_rst_asserted(TEGRA20_CLK_VDE);
-    int clk_en = tegra_clk_enabled(TEGRA20_CLK_VDE);
-    uint32_t base;
-    uint32_t mask;
-
-    switch (offset) {
-    case 0x0000 ... 0x00FF:
-        base = 0x60010000;
-        mask = 0xFF;
-        break;
-    case 0xA000 ... 0xAFFF:
-        base = 0x6001A000;
-        mask = 0xFFF;
-        break;
-    case 0xB000 ... 0xBFFF:
-        base = 0x6001B000;
-        mask = 0xFFF;
-        break;
-    case 0xC000 ... 0xC0FF:
-        base = 0x6001C000;
-        mask = 0xFF;
-        break;
-    case 0xC200 ... 0xC2FF:
-        base = 0x6001C200;
-        mask = 0xFF;
-        break;
-    case 0xC400 ... 0xC4FF:
-        base = 0x6001C400;
-        mask = 0xFF;
-        break;
-    case 0xC600 ... 0xC6FF:
-        base = 0x6001C600;
-        mask = 0xFF;
-        break;
-    case 0xC800 ... 0xC8FF:
-        base = 0x6001C800;
-        mask = 0xFF;
-        break;
-    case 0xCA00 ... 0xCAFF:
-        base = 0x6001CA00;
-        mask = 0xFF;
-        break;
-    case 0xCC00 ... 0xCCFF:
-        base = 0x6001CC00;
-        mask = 0xFF;
-        break;
-    case 0xD000 ... 0xD7FF:
-        base = 0x6001D000;
-        mask = 0x7FF;
-        break;
-    case 0xD800 ... 0xDAFF:
-        base = 0x6001D800;
-        mask = 0x3FF;
-        break;
-    default:
-        base = s->iomem.addr;
-        mask = 0xFFFF;
-        break;
-    }
 
-    TRACE_READ_EXT(base, offset & mask, ret, !clk_en, rst_set);
+    if (tegra_trace_event_enabled(TEGRA_TRACE_EV_RW))
+        bse_remote_trace(s, offset, ret, 0);
 
     return ret;
 }
@@ -113,67 +91,9 @@ static void bse_remote_write(void *opaque, hwaddr offset,
                               uint64_t value, unsigned size)
 {
     bse_remote *s = opaque;
-    int rst_set = tegra_rst_asserted(TEGRA20_CLK_VDE);
-    int clk_en = tegra_clk_enabled(TEGRA20_CLK_VDE);
-    uint32_t base;
-    uint32_t mask;
-
-    switch (offset) {
-    case 0x0000 ... 0x00FF:
-        base = 0x60010000;
-        mask = 0xFF;
-        break;
-    case 0xA000 ... 0xAFFF:
-        base = 0x6001A000;
-        mask = 0xFFF;
-        break;
-    case 0xB000 ... 0xBFFF:
-        base = 0x6001B000;
-        mask = 0xFFF;
-        break;
-    case 0xC000 ... 0xC0FF:
-        base = 0x6001C000;
-        mask = 0xFF;
-        break;
-    case 0xC200 ... 0xC2FF:
-        base = 0x6001C200;
-        mask = 0xFF;
-        break;
-    case 0xC400 ... 0xC4FF:
-        base = 0x6001C400;
-        mask = 0xFF;
-        break;
-    case 0xC600 ... 0xC6FF:
-        base = 0x6001C600;
-        mask = 0xFF;
-        break;
-    case 0xC800 ... 0xC8FF:
-        base = 0x6001C800;
-        mask = 0xFF;
-        break;
-    case 0xCA00 ... 0xCAFF:
-        base = 0x6001CA00;
-        mask = 0xFF;
-        break;
-    case 0xCC00 ... 0xCCFF:
-        base = 0x6001CC00;
-        mask = 0xFF;
-        break;
-    case 0xD000 ... 0xD7FF:
-        base = 0x6001D000;
-        mask = 0x7FF;
-        break;
-    case 0xD800 ... 0xDAFF:
-        base = 0x6001D800;
-        mask = 0x3FF;
-        break;
-    default:
-        base = s->iomem.addr;
-        mask = 0xFFFF;
-        break;
-    }
 
-    TRACE_WRITE_EXT(base, offset & mask, value, value, !clk_en, rst_set);
+    if (tegra_trace_event_enabled(TEGRA_TRACE_EV_RW))
+        bse_remote_trace(s, offset, value, 1);
 
     remote_io_write(value, s->iomem.addr + offset, size << 3);
 }
@@ -188,10 +108,13 @@ static void tegra_vde_bse_priv_realize(DeviceState *dev, Error **errp)
 {
     bse_remote *s = TEGRA_BSE_REMOTE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &bse_remote_mem_ops, s,
-                          "tegra.vde_bse", 0xDB00);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &bse_remote_mem_ops, s,
+                       "tegra.vde_bse", 0xDB00);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
+    tegra_mmio_windows_init(&s->windows, bse_remote_windows,
+                            ARRAY_SIZE(bse_remote_windows));
+
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_ucq_error);
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_sync_token);
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_bse_v);
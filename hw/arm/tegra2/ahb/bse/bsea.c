@@ -146,56 +146,6 @@ out:
     return ret;
 }
 
-static void AES_cbc_encrypt(const unsigned char *in, unsigned char *out,
-                            const unsigned long length, const AES_KEY *key,
-                            unsigned char *ivec, const int enc)
-{
-        unsigned long n;
-        unsigned long len = length;
-        unsigned char tmp[AES_BLOCK_SIZE];
-
-        assert(in && out && key && ivec);
-
-        if (enc) {
-                while (len >= AES_BLOCK_SIZE) {
-                        for(n=0; n < AES_BLOCK_SIZE; ++n)
-                                tmp[n] = in[n] ^ ivec[n];
-                        AES_encrypt(tmp, out, key);
-                        memcpy(ivec, out, AES_BLOCK_SIZE);
-                        len -= AES_BLOCK_SIZE;
-                        in += AES_BLOCK_SIZE;
-                        out += AES_BLOCK_SIZE;
-                }
-                if (len) {
-                        for(n=0; n < len; ++n)
-                                tmp[n] = in[n] ^ ivec[n];
-                        for(n=len; n < AES_BLOCK_SIZE; ++n)
-                                tmp[n] = ivec[n];
-                        AES_encrypt(tmp, tmp, key);
-                        memcpy(out, tmp, AES_BLOCK_SIZE);
-                        memcpy(ivec, tmp, AES_BLOCK_SIZE);
-                }
-        } else {
-                while (len >= AES_BLOCK_SIZE) {
-                        memcpy(tmp, in, AES_BLOCK_SIZE);
-                        AES_decrypt(in, out, key);
-                        for(n=0; n < AES_BLOCK_SIZE; ++n)
-                                out[n] ^= ivec[n];
-                        memcpy(ivec, tmp, AES_BLOCK_SIZE);
-                        len -= AES_BLOCK_SIZE;
-                        in += AES_BLOCK_SIZE;
-                        out += AES_BLOCK_SIZE;
-                }
-                if (len) {
-                        memcpy(tmp, in, AES_BLOCK_SIZE);
-                        AES_decrypt(tmp, tmp, key);
-                        for(n=0; n < len; ++n)
-                                out[n] = tmp[n] ^ ivec[n];
-                        memcpy(ivec, tmp, AES_BLOCK_SIZE);
-                }
-        }
-}
-
 static void tegra_exec_icmd(tegra_bse *s, uint64_t value)
 {
     uint8_t opcode = value >> 26;
@@ -227,9 +177,11 @@ static void tegra_exec_icmd(tegra_bse *s, uint64_t value)
                                       "@0x%X [slot=%d]\n",
                         (uint32_t) table_addr, slot);
 
-                if (s->secure_sec_sel[slot].keyupdate_enb)
+                if (s->secure_sec_sel[slot].keyupdate_enb) {
                     dma_memory_read(&address_space_memory, table_addr,
                                     s->aes_key[slot], 32);
+                    tegra_bse_aes_key_changed(s, slot);
+                }
             }
             break;
         }
@@ -255,110 +207,51 @@ static void tegra_exec_icmd(tegra_bse *s, uint64_t value)
         int slot = s->secure_config.secure_key_index;
         int rng_en = s->secure_input_select.secure_rng_enb;
         int blk_cnt = cmd.block_count + 1;
-        hwaddr len_out = AES_BLOCK_SIZE * blk_cnt;
-        hwaddr len_in = AES_BLOCK_SIZE * blk_cnt;
-        dma_addr_t dma_src_addr = s->src_addr;
-        dma_addr_t dma_dst_addr = s->secure_dest_addr.reg32;
         int is_enc = s->secure_input_select.secure_core_sel;
         int key_len = s->secure_input_select.input_key_len;
-        void *buffer_in;
-        void *buffer_out;
-        AES_KEY key;
+        int hash_en = s->secure_input_select.secure_hash_enb;
+        tegra_bse_job *job;
 
         TPRINT("BSEA: cmd: opcode=CMD_BLKSTARTENGINE block_count=%d\n",
                 blk_cnt);
 
-        buffer_in = dma_memory_map(&address_space_memory,
-                                   dma_src_addr, &len_in,
-                                   DMA_DIRECTION_TO_DEVICE);
-
-        buffer_out = dma_memory_map(&address_space_memory,
-                                    dma_dst_addr, &len_out,
-                                    DMA_DIRECTION_FROM_DEVICE);
-
-        g_assert(buffer_in != NULL);
-        g_assert(buffer_out != NULL);
-
         if (s->state & FAKE) {
             TPRINT("BSEA: return fake\n");
-            memcpy(buffer_out, fake, sizeof(fake));
-            goto unmap;
-        }
-
-        if (is_enc)
-            AES_set_encrypt_key(s->aes_key[slot], key_len, &key);
-        else
-            AES_set_decrypt_key(s->aes_key[slot], key_len, &key);
-
-        if (xor_pos >> 1) {
-            TPRINT("BSEA: %s using CBC algo 0x%08X -> 0x%08X key_len=%d\n",
-                   is_enc ? "encrypting" : "decrypting", s->src_addr,
-                   s->secure_dest_addr.reg32, key_len);
-
-            TPRINT("BSEA: --------- IV [SLOT=%d] --------\n", slot);
-            tegra_debug_buffer(s, s->aes_iv[slot], 1);
-
-            TPRINT("BSEA: --------- KEY [SLOT=%d] --------\n", slot);
-            tegra_debug_buffer(s, s->aes_key[slot], 1);
-
-            TPRINT("BSEA: ----------- IN %s ----------\n",
-                   is_enc ? "CLEARTEXT" : "CIPHER");
-            tegra_debug_buffer(s, buffer_in, blk_cnt);
-
-            AES_cbc_encrypt(buffer_in, buffer_out, blk_cnt * AES_BLOCK_SIZE,
-                            &key, s->aes_iv[slot], is_enc);
+            dma_memory_write(&address_space_memory, s->secure_dest_addr.reg32,
+                             fake, sizeof(fake));
+            s->state = IDLE;
 
-            TPRINT("BSEA: ----------- OUT %s ----------\n",
-                   is_enc ? "CIPHER" : "CLEARTEXT");
-            tegra_debug_buffer(s, buffer_out, blk_cnt);
-
-            goto unmap;
+            TRACE_IRQ_RAISE(s->iomem.addr, s->irq);
+            break;
         }
 
-        /* presume ECB mode */
-        if (!rng_en) {
-            int i;
-
-            TPRINT("BSEA: %s using ECB algo 0x%08X -> 0x%08X\n",
-                   is_enc ? "encrypting" : "decrypting",
-                   s->src_addr, s->secure_dest_addr.reg32);
-
+        job = g_new0(tegra_bse_job, 1);
+        job->hash = hash_en;
+        job->hash_dest = s->secure_input_select.secure_hash_dest;
+        job->cbc = (xor_pos >> 1) || hash_en;
+        job->rng = !job->cbc && rng_en;
+        job->enc = is_enc || hash_en;
+
+        /* presume ECB mode if none of the above */
+        TPRINT("BSEA: %s using %s algo 0x%08X -> 0x%08X key_len=%d\n",
+               job->enc ? "encrypting" : "decrypting",
+               job->hash ? "CBC-MAC" : job->rng ? "RNG" :
+               job->cbc ? "CBC" : "ECB", s->src_addr,
+               s->secure_dest_addr.reg32, key_len);
+
+        if (slot < SLOTS_MAX_NB) {
             TPRINT("BSEA: --------- KEY [SLOT=%d] --------\n", slot);
             tegra_debug_buffer(s, s->aes_key[slot], 1);
-
-            TPRINT("BSEA: ----------- IN %s ----------\n",
-                    is_enc ? "CLEARTEXT" : "CIPHER");
-            tegra_debug_buffer(s, buffer_in, blk_cnt);
-
-            for (i = 0; i < blk_cnt; i++) {
-                uint32_t offset = i * AES_BLOCK_SIZE;
-
-                if (is_enc)
-                    AES_encrypt(buffer_in + offset, buffer_out + offset, &key);
-                else
-                    AES_decrypt(buffer_in + offset, buffer_out + offset, &key);
-            }
-
-            TPRINT("BSEA: ----------- OUT %s ----------\n",
-                   is_enc ? "CIPHER" : "CLEARTEXT");
-            tegra_debug_buffer(s, buffer_out, blk_cnt);
-
-            goto unmap;
         }
 
-        TPRINT("BSEA: unimplemented!!!!\n");
-        g_assert_not_reached();
-
-unmap:
-        dma_memory_unmap(&address_space_memory, buffer_in, dma_src_addr,
-                            DMA_DIRECTION_TO_DEVICE, len_in);
+        job->src = s->src_addr;
+        job->dst = s->secure_dest_addr.reg32;
+        job->len = AES_BLOCK_SIZE * blk_cnt;
+        job->slot = slot;
+        job->key_len = key_len;
 
-        dma_memory_unmap(&address_space_memory, buffer_out, dma_dst_addr,
-                            DMA_DIRECTION_FROM_DEVICE, len_out);
         s->state = IDLE;
-
-        TRACE_IRQ_RAISE(s->iomem.addr, s->irq);
-
+        tegra_bse_aes_submit(s, job);
         break;
     }
     case CMD_MEMDMAVD:
@@ -445,6 +338,8 @@ static void tegra_bse_priv_reset(DeviceState *dev)
     tegra_bse *s = TEGRA_BSE(dev);
     int i;
 
+    tegra_bse_aes_reset(s);
+
     s->cmdque_control.reg32 = CMDQUE_CONTROL_RESET;
     s->intr_status.reg32 = INTR_STATUS_RESET;
     s->bse_config.reg32 = BSE_CONFIG_RESET;
@@ -476,11 +371,13 @@ static void tegra_bse_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_bse *s = TEGRA_BSE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_bse_mem_ops, s,
-                          "tegra.bsea", TEGRA_BSEA_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_bse_mem_ops, s,
+                       "tegra.bsea", TEGRA_BSEA_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq);
+
+    tegra_bse_aes_init(s);
 }
 
 static Property tegra_bse_props[] = {
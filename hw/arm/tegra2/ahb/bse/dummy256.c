@@ -78,8 +78,8 @@ static void tegra_bse_dummy_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_dummy *s = TEGRA_DUMMY(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_dummy_mem_ops, s,
-                          "tegra.bse_dummy", 256);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_dummy_mem_ops, s,
+                       "tegra.bse_dummy", 256);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
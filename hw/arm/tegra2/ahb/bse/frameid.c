@@ -74,8 +74,8 @@ static void tegra_vde_frameid_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_frameid *s = TEGRA_VDE_FRAMEID(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_frameid_mem_ops, s,
-                          "tegra.vde_frameid", 768);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_frameid_mem_ops, s,
+                       "tegra.vde_frameid", 768);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -74,8 +74,8 @@ static void tegra_vde_mbe_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_mbe *s = TEGRA_VDE_MBE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_mbe_mem_ops, s,
-                          "tegra.vde_mbe", 256);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_mbe_mem_ops, s,
+                       "tegra.vde_mbe", 256);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
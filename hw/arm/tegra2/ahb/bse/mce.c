@@ -74,8 +74,8 @@ static void tegra_vde_mce_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_mce *s = TEGRA_VDE_MCE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_mce_mem_ops, s,
-                          "tegra.vde_mce", 256);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_mce_mem_ops, s,
+                       "tegra.vde_mce", 256);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
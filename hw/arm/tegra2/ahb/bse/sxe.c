@@ -95,8 +95,8 @@ static void tegra_vde_sxe_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_sxe *s = TEGRA_VDE_SXE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_sxe_mem_ops, s,
-                          "tegra.vde_sxe", 0x1000);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_sxe_mem_ops, s,
+                       "tegra.vde_sxe", 0x1000);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -74,8 +74,8 @@ static void tegra_vde_tfe_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_tfe *s = TEGRA_VDE_TFE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_tfe_mem_ops, s,
-                          "tegra.vde_tfe", 256);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_tfe_mem_ops, s,
+                       "tegra.vde_tfe", 256);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -74,8 +74,8 @@ static void tegra_vde_vdma_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_vdma *s = TEGRA_VDE_VDMA(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_vdma_mem_ops, s,
-                          "tegra.vde_vdma", 256);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_vdma_mem_ops, s,
+                       "tegra.vde_vdma", 256);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
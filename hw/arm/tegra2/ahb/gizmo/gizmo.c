@@ -445,8 +445,8 @@ static void tegra_ahb_gizmo_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_ahb_gizmo *s = TEGRA_AHB_GIZMO(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_ahb_gizmo_mem_ops, s,
-                          "tegra.ahb_gizmo", TEGRA_AHB_GIZMO_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_ahb_gizmo_mem_ops, s,
+                       "tegra.ahb_gizmo", TEGRA_AHB_GIZMO_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -19,6 +19,13 @@
 
 #include "tegra_common.h"
 
+#include "exec/address-spaces.h"
+#include "qapi/error.h"
+#include "qemu/coroutine.h"
+#include "qemu/main-loop.h"
+#include "qemu/rcu.h"
+#include "qemu/timer.h"
+#include "sysemu/iothread.h"
 
 #include "host1x_cdma.h"
 #include "host1x_cmd_processor.h"
@@ -27,42 +34,247 @@
 #include "tegra_trace.h"
 
 /* TODO: get rid of globals */
-void *host1x_dma_ptr;
 __thread struct host1x_cdma *host1x_cdma_ptr;
 
-static void *host1x_cdma_thr(void *opaque)
+/*
+ * Channels are coroutines on a single IOThread.  A channel yields while it
+ * waits for a syncpoint or a module lock, host1x_cdma_ptr is restored when
+ * the coroutine is re-entered since all the channels share the thread.
+ */
+static IOThread *host1x_iothread;
+
+/*
+ * Channels are time-sliced in weighted round robin: once a channel used up
+ * its slice of opcodes it yields to the other active channels, channels set
+ * in CHANNEL_PRIORITY get HOST1X_CDMA_HIPRI_WEIGHT times longer slices.
+ */
+#define HOST1X_CDMA_SLICE           64
+#define HOST1X_CDMA_HIPRI_WEIGHT    4
+
+static channel_priority_t host1x_cdma_priority;
+static unsigned int host1x_cdma_nr_active;
+static unsigned int host1x_cdma_nr_syncpt_wait;
+
+static void host1x_cdma_trace_stats(struct host1x_cdma *cdma)
+{
+    struct host1x_cdma_stats *st = &cdma->stats;
+
+    TPRINT("cdma%d stats words=%" PRIu64 " gathers=%" PRIu64
+           " syncpt_wait=%" PRIu64 "ns mlock_wait=%" PRIu64
+           "ns bql_hold=%" PRIu64 "ns\n",
+           cdma->ch_id, stat64_get(&st->words), stat64_get(&st->gathers),
+           stat64_get(&st->syncpt_wait_ns), stat64_get(&st->mlock_wait_ns),
+           stat64_get(&st->bql_hold_ns));
+}
+
+/*
+ * Push buffer pages are mapped on the first fetch and stay mapped until the
+ * channel goes idle, so fetches from cached pages are plain loads.  Anything
+ * that isn't RAM is read through the address space.
+ */
+static void host1x_cdma_unmap_page(struct host1x_cdma_page *page)
+{
+    if (!page->ptr)
+        return;
+
+    address_space_unmap(&address_space_memory, page->ptr,
+                        HOST1X_CDMA_PAGE_SIZE, false, 0);
+    page->ptr = NULL;
+}
+
+static void host1x_cdma_unmap_pages(struct host1x_cdma *cdma)
+{
+    int i;
+
+    for (i = 0; i < HOST1X_CDMA_PAGES_NB; i++)
+        host1x_cdma_unmap_page(&cdma->pages[i]);
+}
+
+static bool host1x_cdma_map_page(struct host1x_cdma_page *page, hwaddr addr)
+{
+    hwaddr len = HOST1X_CDMA_PAGE_SIZE;
+    MemoryRegion *mr;
+    hwaddr xlat;
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        mr = address_space_translate(&address_space_memory, addr, &xlat, &len,
+                                     false, MEMTXATTRS_UNSPECIFIED);
+        if (!memory_region_is_ram(mr) || len != HOST1X_CDMA_PAGE_SIZE)
+            return false;
+    }
+
+    page->ptr = address_space_map(&address_space_memory, addr, &len, false,
+                                  MEMTXATTRS_UNSPECIFIED);
+    if (!page->ptr)
+        return false;
+
+    if (len != HOST1X_CDMA_PAGE_SIZE) {
+        address_space_unmap(&address_space_memory, page->ptr, len, false, 0);
+        page->ptr = NULL;
+        return false;
+    }
+
+    page->addr = addr;
+
+    return true;
+}
+
+/* Returns false if nothing backs the address.  */
+bool host1x_cdma_read(struct host1x_cdma *cdma, hwaddr addr, uint32_t *data)
+{
+    hwaddr page_addr = addr & ~(hwaddr)(HOST1X_CDMA_PAGE_SIZE - 1);
+    struct host1x_cdma_page *page;
+    MemTxResult res;
+    int i;
+
+    for (i = 0; i < HOST1X_CDMA_PAGES_NB; i++) {
+        page = &cdma->pages[i];
+
+        if (page->ptr && page->addr == page_addr)
+            goto hit;
+    }
+
+    page = &cdma->pages[cdma->next_page];
+    cdma->next_page = (cdma->next_page + 1) % HOST1X_CDMA_PAGES_NB;
+
+    host1x_cdma_unmap_page(page);
+
+    if (!host1x_cdma_map_page(page, page_addr)) {
+        res = address_space_read(&address_space_memory, addr,
+                                 MEMTXATTRS_UNSPECIFIED, data, 4);
+        le32_to_cpus(data);
+
+        return res == MEMTX_OK;
+    }
+hit:
+    *data = ldl_le_p(page->ptr + (addr - page_addr));
+
+    return true;
+}
+
+static void coroutine_fn host1x_cdma_process(struct host1x_cdma *cdma)
 {
-    struct host1x_cdma *cdma = opaque;
     struct host1x_dma_gather *gather = &cdma->gather;
 
     host1x_cdma_ptr = cdma;
+    gather->base = cdma->base;
 
-    for (;;) {
-        qemu_event_wait(&cdma->start_ev);
-        qemu_event_reset(&cdma->start_ev);
+    TPRINT("cdma%d start base=0x%08X get=0x%08X put=0x%08X end=0x%08X\n",
+           cdma->ch_id, gather->base << 2, gather->get << 2,
+           gather->put << 2, cdma->end << 2);
+
+    TRACE_CDMA_START(cdma->ch_id);
+
+    process_cmd_buf(gather);
+    host1x_cdma_unmap_pages(cdma);
+
+    TRACE_CDMA_STOP(cdma->ch_id);
 
-        gather->base = cdma->base;
+    host1x_cdma_trace_stats(cdma);
 
-        TPRINT("cdma%d start base=0x%08X get=0x%08X put=0x%08X end=0x%08X\n",
-               cdma->ch_id, gather->base << 2, gather->get << 2,
-               gather->put << 2, cdma->end << 2);
+    TPRINT("cdma%d stop\n", cdma->ch_id);
+    qemu_event_set(&cdma->stop_ev);
+}
 
-        TRACE_CDMA_START(cdma->ch_id);
+static void coroutine_fn host1x_cdma_co(void *opaque)
+{
+    struct host1x_cdma *cdma = opaque;
 
-        process_cmd_buf(gather);
+    for (;;) {
+        while (qatomic_xchg(&cdma->kick, false))
+            host1x_cdma_process(cdma);
 
-        TRACE_CDMA_STOP(cdma->ch_id);
+        qatomic_set(&cdma->running, false);
+        qatomic_dec(&host1x_cdma_nr_active);
+        /* Pairs with host1x_cdma_run(), so that a kick is never lost.  */
+        smp_mb();
 
-        TPRINT("cdma%d stop\n", cdma->ch_id);
-        qemu_event_set(&cdma->stop_ev);
+        if (!qatomic_read(&cdma->kick) || qatomic_xchg(&cdma->running, true))
+            break;
+
+        qatomic_inc(&host1x_cdma_nr_active);
     }
+}
+
+void coroutine_fn host1x_cdma_yield(void)
+{
+    struct host1x_cdma *cdma = host1x_cdma_ptr;
 
-    return NULL;
+    qemu_coroutine_yield();
+    host1x_cdma_ptr = cdma;
+}
+
+static int host1x_cdma_slice(struct host1x_cdma *cdma)
+{
+    uint32_t hipri = qatomic_read(&host1x_cdma_priority.reg32);
+
+    if (hipri & (1 << cdma->ch_id))
+        return HOST1X_CDMA_SLICE * HOST1X_CDMA_HIPRI_WEIGHT;
+
+    return HOST1X_CDMA_SLICE;
+}
+
+/* Called by the channel before every opcode, without the BQL.  */
+void coroutine_fn host1x_cdma_sched(struct host1x_cdma *cdma)
+{
+    if (--cdma->slice > 0)
+        return;
+
+    cdma->slice = host1x_cdma_slice(cdma);
+
+    if (qatomic_read(&host1x_cdma_nr_active) < 2)
+        return;
+
+    stat64_add(&cdma->stats.slices, 1);
+
+    aio_co_schedule(iothread_get_aio_context(host1x_iothread),
+                    qemu_coroutine_self());
+    host1x_cdma_yield();
+}
+
+/*
+ * Whether any channel has work queued or is blocked in the middle of it.
+ * Channels waiting for a syncpoint don't count, the increment they wait
+ * for comes from another channel or from the CPU.
+ */
+bool host1x_cdma_busy(void)
+{
+    return qatomic_read(&host1x_cdma_nr_active) >
+           qatomic_read(&host1x_cdma_nr_syncpt_wait);
+}
+
+uint32_t host1x_cdma_get_priority(void)
+{
+    return qatomic_read(&host1x_cdma_priority.reg32);
+}
+
+void host1x_cdma_set_priority(uint32_t value)
+{
+    channel_priority_t priority = { .reg32 = value };
+
+    priority.undefined_bits_8_31 = 0;
+    qatomic_set(&host1x_cdma_priority.reg32, priority.reg32);
+}
+
+/* Push buffer words the channel didn't process yet.  */
+uint32_t host1x_cdma_queue_depth(struct host1x_cdma *cdma)
+{
+    struct host1x_dma_gather *gather = &cdma->gather;
+    uint32_t get = gather->get, put = gather->put;
+
+    if (!cdma->enabled)
+        return 0;
+
+    if (put >= get)
+        return put - get;
+
+    return cdma->end - get + put;
 }
 
 static void host1x_cdma_run(struct host1x_cdma *cdma)
 {
     struct host1x_dma_gather *gather = &cdma->gather;
+    Coroutine *co;
 
     if (!cdma->enabled)
         return;
@@ -71,7 +283,15 @@ static void host1x_cdma_run(struct host1x_cdma *cdma)
         return;
 
     qemu_event_reset(&cdma->stop_ev);
-    qemu_event_set(&cdma->start_ev);
+    qatomic_set(&cdma->kick, true);
+
+    if (qatomic_xchg(&cdma->running, true))
+        return;
+
+    qatomic_inc(&host1x_cdma_nr_active);
+
+    co = qemu_coroutine_create(host1x_cdma_co, cdma);
+    aio_co_schedule(iothread_get_aio_context(host1x_iothread), co);
 }
 
 void host1x_cdma_set_base(struct host1x_cdma *cdma, uint32_t base)
@@ -96,7 +316,7 @@ void host1x_cdma_control(struct host1x_cdma *cdma,
 {
     if (dma_stop) {
         cdma->enabled = 0;
-        host1x_wake_mlocked_channels();
+        host1x_wake_mlocked_channel(cdma);
         host1x_unlock_syncpt_waiter_forced(&cdma->waiter);
     }
 
@@ -111,27 +331,75 @@ void host1x_cdma_control(struct host1x_cdma *cdma,
     }
 }
 
+/*
+ * Brackets a syncpoint wait of the channel: it doesn't count as busy while
+ * blocked, and since the wait drops the BQL, the waited time is excluded
+ * from the BQL hold time.
+ */
+int64_t host1x_cdma_syncpt_wait(struct host1x_cdma *cdma)
+{
+    if (cdma)
+        qatomic_inc(&host1x_cdma_nr_syncpt_wait);
+
+    return get_clock();
+}
+
+void host1x_cdma_syncpt_waited(struct host1x_cdma *cdma, int64_t start)
+{
+    int64_t waited;
+
+    /* Indirect write by a vCPU, not a channel.  */
+    if (!cdma)
+        return;
+
+    qatomic_dec(&host1x_cdma_nr_syncpt_wait);
+
+    waited = get_clock() - start;
+
+    stat64_add(&cdma->stats.syncpt_wait_ns, waited);
+    cdma->bql_locked_at += waited;
+}
+
+void host1x_cdma_reset_stats(struct host1x_cdma *cdma)
+{
+    struct host1x_cdma_stats *st = &cdma->stats;
+    int i;
+
+    stat64_init(&st->words, 0);
+    stat64_init(&st->gathers, 0);
+    stat64_init(&st->syncpt_wait_ns, 0);
+    stat64_init(&st->mlock_wait_ns, 0);
+    stat64_init(&st->bql_hold_ns, 0);
+    stat64_init(&st->slices, 0);
+
+    for (i = 0; i < ARRAY_SIZE(st->opcodes); i++)
+        stat64_init(&st->opcodes[i], 0);
+}
+
 void host1x_init_cdma(struct host1x_cdma *cdma, uint8_t ch_id)
 {
-    qemu_event_init(&cdma->start_ev, 0);
+    int i;
+
     qemu_event_init(&cdma->stop_ev, 1);
-    qemu_thread_create(&cdma->thread, "cdma", host1x_cdma_thr, cdma,
-                       QEMU_THREAD_DETACHED);
     cdma->gather.cdma = cdma;
     cdma->gather.inlined = 0;
     cdma->module = NULL;
     cdma->ch_id = ch_id;
     cdma->enabled = 0;
+    cdma->running = false;
+    cdma->kick = false;
+    cdma->next_page = 0;
+    cdma->slice = host1x_cdma_slice(cdma);
 
+    for (i = 0; i < HOST1X_CDMA_PAGES_NB; i++)
+        cdma->pages[i].ptr = NULL;
+
+    host1x_cdma_reset_stats(cdma);
     host1x_init_syncpt_waiter(&cdma->waiter);
+    host1x_gather_cache_init(cdma);
 }
 
 void host1x_init_dma(void)
 {
-    dma_addr_t dma_sz = 0x3fffffff;
-
-    host1x_dma_ptr = dma_memory_map(&address_space_memory, 0, &dma_sz,
-                                    DMA_DIRECTION_TO_DEVICE);
-
-    g_assert(host1x_dma_ptr != NULL);
+    host1x_iothread = iothread_create("tegra-host1x", &error_fatal);
 }
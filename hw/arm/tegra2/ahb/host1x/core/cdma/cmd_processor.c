@@ -20,6 +20,7 @@
 #include "tegra_common.h"
 
 #include "qemu/main-loop.h"
+#include "qemu/timer.h"
 #include "sysemu/dma.h"
 
 #include "host1x_cdma.h"
@@ -29,6 +30,18 @@
 
 #include "tegra_trace.h"
 
+static void cdma_lock_iothread(struct host1x_cdma *cdma)
+{
+    qemu_mutex_lock_iothread();
+    cdma->bql_locked_at = get_clock();
+}
+
+static void cdma_unlock_iothread(struct host1x_cdma *cdma)
+{
+    stat64_add(&cdma->stats.bql_hold_ns, get_clock() - cdma->bql_locked_at);
+    qemu_mutex_unlock_iothread();
+}
+
 static int dma_range_is_valid(struct host1x_dma_gather *gather)
 {
     struct host1x_cdma *cdma = gather->cdma;
@@ -76,19 +89,40 @@ static int cdma_stopped(struct host1x_dma_gather *gather)
     return 0;
 }
 
+/* Stops the channel on a bad push buffer address.  */
+static bool cdma_fetch(struct host1x_dma_gather *gather, uint32_t *data)
+{
+    struct host1x_cdma *cdma = gather->cdma;
+    hwaddr addr = ((hwaddr) gather->base + gather->get++) << 2;
+
+    if (host1x_cdma_read(cdma, addr, data))
+        return true;
+
+    TPRINT("%s: error cdma=%d bad address=0x%" HWADDR_PRIX
+           " gather_inlined=%d\n", __func__, cdma->ch_id, addr,
+           gather->inlined);
+
+    cdma->enabled = 0;
+
+    return false;
+}
+
 static void module_feed(struct host1x_dma_gather *gather,
                         uint16_t offset, uint16_t count, bool incr)
 {
     struct host1x_cdma *cdma = gather->cdma;
     struct host1x_module *module = cdma->module;
-    uint32_t *cmd_buf = host1x_dma_ptr + (gather->base << 2);
-    uint32_t i;
+    uint32_t i, data;
 
     for (i = 0; i < count; i++) {
         if (cdma_stopped(gather))
             return;
 
-        host1x_module_write(module, offset, cmd_buf[gather->get++]);
+        if (!cdma_fetch(gather, &data))
+            return;
+
+        host1x_module_write(module, offset, data);
+        stat64_add(&cdma->stats.words, 1);
 
         if (incr)
             offset++;
@@ -100,32 +134,88 @@ static void module_feed_masked(struct host1x_dma_gather *gather,
 {
     struct host1x_cdma *cdma = gather->cdma;
     struct host1x_module *module = cdma->module;
-    uint32_t *cmd_buf = host1x_dma_ptr + (gather->base << 2);
-    uint32_t i;
+    uint32_t i, data;
 
     FOREACH_BIT_SET(mask, i, mask_size) {
         if (cdma_stopped(gather))
             return;
 
-        host1x_module_write(module, offset + i, cmd_buf[gather->get++]);
+        if (!cdma_fetch(gather, &data))
+            return;
+
+        host1x_module_write(module, offset + i, data);
+        stat64_add(&cdma->stats.words, 1);
+    }
+}
+
+/*
+ * Replays a memoised decode of a non-insert gather, skipping opcode decode
+ * and the bounds checks.  Called with the BQL held, returns false if the
+ * gather has to be processed the regular way.
+ */
+static bool coroutine_fn replay_gather(struct host1x_dma_gather *gather)
+{
+    struct host1x_cdma *cdma = gather->cdma;
+    struct host1x_gather_decode *dec;
+    unsigned int i;
+
+    /* Trace has to see every word.  */
+    if (tegra_trace_event_enabled(TEGRA_TRACE_EV_CDMA))
+        return false;
+
+    dec = host1x_gather_cache_lookup(cdma, (hwaddr) gather->base << 2,
+                                     gather->put);
+    if (!dec)
+        return false;
+
+    stat64_add(&cdma->stats.words, dec->words);
+    for (i = 0; i < ARRAY_SIZE(dec->opcodes); i++) {
+        if (dec->opcodes[i])
+            stat64_add(&cdma->stats.opcodes[i], dec->opcodes[i]);
+    }
+
+    for (i = 0; i < dec->nr_ops && cdma->enabled; i++) {
+        struct host1x_gather_op *op = &dec->ops[i];
+
+        /* Same BQL granularity as the regular path, once per opcode.  */
+        if (op->first && i) {
+            cdma_unlock_iothread(cdma);
+            cdma_lock_iothread(cdma);
+        }
+
+        host1x_module_write(op->module, op->offset, op->data);
     }
+
+    cdma->module = dec->end_module;
+    gather->get = gather->put;
+
+    return true;
 }
 
-void process_cmd_buf(struct host1x_dma_gather *gather)
+void coroutine_fn process_cmd_buf(struct host1x_dma_gather *gather)
 {
     struct host1x_cdma *cdma = gather->cdma;
-    uint32_t *cmd_buf = host1x_dma_ptr + (gather->base << 2);
 
     while ( !cdma_stopped(gather) ) {
-        uint32_t cmd = cmd_buf[gather->get++];
-        uint8_t opcode = CMD_OPCODE(cmd);
+        uint32_t cmd;
+        uint8_t opcode;
+
+        host1x_cdma_sched(cdma);
+
+        if (!cdma_fetch(gather, &cmd))
+            return;
+
+        opcode = CMD_OPCODE(cmd);
 
         TRACE_CDMA(cmd, gather->inlined, cdma->ch_id);
 
+        stat64_add(&cdma->stats.words, 1);
+        stat64_add(&cdma->stats.opcodes[opcode], 1);
+
 //         TPRINT("cdma=%d inlined=%d get=0x%X cmd=0x%08X\n",
 //                cdma->ch_id, gather->inlined, gather->get - 1, cmd);
 
-        qemu_mutex_lock_iothread();
+        cdma_lock_iothread(cdma);
 
         switch (opcode) {
         case SETCL:
@@ -164,22 +254,30 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
         {
             struct host1x_dma_gather gather_inlined;
             gather_op op = { .reg32 = cmd };
+            uint32_t gather_base;
 
             g_assert(!gather->inlined);
             g_assert(dma_get_is_valid(gather));
             g_assert(dma_range_is_valid(gather));
 
             if (cdma_stopped(gather)) {
-                qemu_mutex_unlock_iothread();
+                cdma_unlock_iothread(cdma);
                 return;
             }
 
             gather_inlined.get = 0;
             gather_inlined.inlined = 1;
             gather_inlined.cdma = cdma;
-            gather_inlined.base = cmd_buf[gather->get++] >> 2;
+            if (!cdma_fetch(gather, &gather_base)) {
+                cdma_unlock_iothread(cdma);
+                return;
+            }
+
+            gather_inlined.base = gather_base >> 2;
             gather_inlined.put = op.count;
 
+            stat64_add(&cdma->stats.words, 1);
+
             TPRINT("gather base=0x%08X count=%d insert=%d\n",
                    gather_inlined.base << 2, op.count, op.insert);
 
@@ -189,12 +287,14 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
             if (!dma_get_is_valid(&gather_inlined))
                 break;
 
+            stat64_add(&cdma->stats.gathers, 1);
+
             if (op.insert)
                 module_feed(&gather_inlined, op.offset, op.count, op.incr);
-            else {
-                qemu_mutex_unlock_iothread();
+            else if (!replay_gather(&gather_inlined)) {
+                cdma_unlock_iothread(cdma);
                 process_cmd_buf(&gather_inlined);
-                qemu_mutex_lock_iothread();
+                cdma_lock_iothread(cdma);
             }
             break;
         }
@@ -202,6 +302,9 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
         {
             extend_op op = { .reg32 = cmd };
 
+            /* Module locks have their own locking and may yield.  */
+            cdma_unlock_iothread(cdma);
+
             switch (op.subop) {
             case ACQUIRE_MLOCK:
                 host1x_ch_acquire_mlock(cdma, op.value & 0xf);
@@ -214,6 +317,8 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
                        __func__, op.subop, cmd);
                 g_assert_not_reached();
             }
+
+            cdma_lock_iothread(cdma);
             break;
         }
         case RESTART:
@@ -226,7 +331,7 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
             cdma->gather.get = op.offset << 2;
 
             if (gather->inlined) {
-                qemu_mutex_unlock_iothread();
+                cdma_unlock_iothread(cdma);
                 return;
             }
             break;
@@ -239,6 +344,6 @@ void process_cmd_buf(struct host1x_dma_gather *gather)
             g_assert_not_reached();
         }
 
-        qemu_mutex_unlock_iothread();
+        cdma_unlock_iothread(cdma);
     }
 }
@@ -0,0 +1,388 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decoded gathers cache.
+ *
+ * Userspace drivers submit the same gathers over and over, so the register
+ * writes of a gather are decoded once and replayed afterwards.  Entries are
+ * per channel and keyed by the gather address, validated by the word count
+ * and the class selected at the gather start.  Backing pages are dirty
+ * logged (VGA client), a written gather gets its content hash recomputed and
+ * is decoded again only if the content really changed.  Gathers of different
+ * channels may share pages, so every page remembers the generation at which
+ * its dirty bit was last cleared and entries validated before that have to
+ * check their hash as well.  Generations older than every live entry can't
+ * fail a check anymore and get pruned once the table grows, full caches
+ * evict their least recently used entry.  All of it is under the BQL.
+ * Gathers that change the command flow (EXTEND, RESTART, nested GATHER) or
+ * aren't backed by contiguous RAM are never cached and go the regular way.
+ */
+
+#include "tegra_common.h"
+
+#include "exec/address-spaces.h"
+#include "exec/ram_addr.h"
+#include "qemu/crc32c.h"
+#include "qemu/rcu.h"
+
+#include "host1x_cdma.h"
+#include "host1x_cmd_processor.h"
+#include "host1x_module.h"
+#include "host1x_priv.h"
+
+#define GATHER_CACHE_SIZE       256
+#define GATHER_PAGE_GENS_MIN    1024
+
+static GHashTable *gather_page_gens;
+static unsigned int gather_page_gens_max = GATHER_PAGE_GENS_MIN;
+static uint32_t gather_gen;
+static GPtrArray *gather_cdmas;
+
+static void gather_decode_free(gpointer data)
+{
+    struct host1x_gather_decode *dec = data;
+
+    g_free(dec->ops);
+    g_free(dec);
+}
+
+static void gather_decode_push(GArray *ops, struct host1x_module *module,
+                               uint16_t offset, uint32_t data, bool *first)
+{
+    struct host1x_gather_op op = {
+        .module = module,
+        .data = data,
+        .offset = offset,
+        .first = *first,
+    };
+
+    g_array_append_val(ops, op);
+    *first = false;
+}
+
+/* Returns false if the gather can't be replayed from a decode.  */
+static bool gather_decode(struct host1x_gather_decode *dec,
+                          const uint32_t *buf, uint32_t count)
+{
+    struct host1x_module *module = dec->start_module;
+    GArray *ops = g_array_new(false, false, sizeof(struct host1x_gather_op));
+    uint32_t i = 0, b;
+
+    while (i < count) {
+        uint32_t cmd = ldl_le_p(&buf[i++]);
+        uint8_t opcode = CMD_OPCODE(cmd);
+        uint16_t offset = 0, mask = 0;
+        uint32_t n = 0;
+        bool first = true;
+        bool incr = false;
+
+        dec->opcodes[opcode]++;
+        dec->words++;
+
+        switch (opcode) {
+        case SETCL:
+        {
+            setcl_op op = { .reg32 = cmd };
+
+            module = get_host1x_module(op.class_id);
+            offset = op.offset;
+            mask = op.mask;
+            break;
+        }
+        case INCR:
+        case NONINCR:
+        {
+            incr_op op = { .reg32 = cmd };
+
+            offset = op.offset;
+            n = op.count;
+            incr = opcode & 1;
+            break;
+        }
+        case MASK:
+        {
+            mask_op op = { .reg32 = cmd };
+
+            offset = op.offset;
+            mask = op.mask;
+            break;
+        }
+        case IMM:
+        {
+            imm_op op = { .reg32 = cmd };
+
+            if (!module)
+                goto uncacheable;
+
+            gather_decode_push(ops, module, op.offset, op.immdata, &first);
+            continue;
+        }
+        case CHDONE:
+            continue;
+        default:
+            goto uncacheable;
+        }
+
+        if ((mask || n) && !module)
+            goto uncacheable;
+
+        /* A truncated opcode ends the gather, like the regular path does.  */
+        FOREACH_BIT_SET(mask, b, 16) {
+            if (i == count)
+                break;
+
+            gather_decode_push(ops, module, offset + b,
+                               ldl_le_p(&buf[i++]), &first);
+            dec->words++;
+        }
+
+        for (b = 0; b < n && i < count; b++) {
+            gather_decode_push(ops, module, offset, ldl_le_p(&buf[i++]),
+                               &first);
+            dec->words++;
+
+            if (incr)
+                offset++;
+        }
+    }
+
+    dec->end_module = module;
+    dec->nr_ops = ops->len;
+    dec->ops = (struct host1x_gather_op *) g_array_free(ops, false);
+
+    return true;
+
+uncacheable:
+    g_array_free(ops, true);
+
+    return false;
+}
+
+/* Maps the gather if it is backed by contiguous RAM, returns NULL if not.  */
+static const uint32_t *gather_map(struct host1x_gather_decode *dec,
+                                  hwaddr *len)
+{
+    MemoryRegion *mr;
+    hwaddr xlat;
+
+    *len = dec->count << 2;
+
+    RCU_READ_LOCK_GUARD();
+
+    mr = address_space_translate(&address_space_memory, dec->addr, &xlat, len,
+                                 false, MEMTXATTRS_UNSPECIFIED);
+    if (!memory_region_is_ram(mr) || *len < (dec->count << 2))
+        return NULL;
+
+    /* The VGA client catches TCG stores and DMA writes alike.  */
+    if (!(memory_region_get_dirty_log_mask(mr) & (1 << DIRTY_MEMORY_VGA)))
+        memory_region_set_log(mr, true, DIRTY_MEMORY_VGA);
+
+    dec->ram_addr = memory_region_get_ram_addr(mr) + xlat;
+
+    return address_space_map(&address_space_memory, dec->addr, len, false,
+                             MEMTXATTRS_UNSPECIFIED);
+}
+
+static bool gather_is_clean(struct host1x_gather_decode *dec)
+{
+    ram_addr_t page = dec->ram_addr >> TARGET_PAGE_BITS;
+    ram_addr_t last = (dec->ram_addr + (dec->count << 2) - 1) >>
+                                                            TARGET_PAGE_BITS;
+
+    if (cpu_physical_memory_get_dirty(dec->ram_addr, dec->count << 2,
+                                      DIRTY_MEMORY_VGA))
+        return false;
+
+    for (; page <= last; page++) {
+        gpointer gen = g_hash_table_lookup(gather_page_gens,
+                                           GSIZE_TO_POINTER(page));
+
+        if (GPOINTER_TO_UINT(gen) > dec->gen)
+            return false;
+    }
+
+    return true;
+}
+
+static gboolean gather_page_gen_is_stale(gpointer key, gpointer value,
+                                         gpointer opaque)
+{
+    return GPOINTER_TO_UINT(value) <= *(uint32_t *) opaque;
+}
+
+static void gather_page_gens_prune(void)
+{
+    struct host1x_gather_decode *dec;
+    uint32_t min_gen = gather_gen;
+    unsigned int i;
+
+    for (i = 0; i < gather_cdmas->len; i++) {
+        struct host1x_cdma *cdma = g_ptr_array_index(gather_cdmas, i);
+
+        QTAILQ_FOREACH(dec, &cdma->gather_lru, lru)
+            min_gen = MIN(min_gen, dec->gen);
+    }
+
+    g_hash_table_foreach_remove(gather_page_gens, gather_page_gen_is_stale,
+                                &min_gen);
+
+    /* Don't rescan on every clear if old entries pin the table.  */
+    gather_page_gens_max = MAX(GATHER_PAGE_GENS_MIN,
+                               g_hash_table_size(gather_page_gens) * 2);
+}
+
+static void gather_clear_dirty(struct host1x_gather_decode *dec)
+{
+    ram_addr_t page = dec->ram_addr >> TARGET_PAGE_BITS;
+    ram_addr_t last = (dec->ram_addr + (dec->count << 2) - 1) >>
+                                                            TARGET_PAGE_BITS;
+
+    if (cpu_physical_memory_test_and_clear_dirty(dec->ram_addr,
+                                                 dec->count << 2,
+                                                 DIRTY_MEMORY_VGA)) {
+        gather_gen++;
+
+        for (; page <= last; page++)
+            g_hash_table_insert(gather_page_gens, GSIZE_TO_POINTER(page),
+                                GUINT_TO_POINTER(gather_gen));
+
+        if (g_hash_table_size(gather_page_gens) > gather_page_gens_max)
+            gather_page_gens_prune();
+    }
+
+    dec->gen = gather_gen;
+}
+
+static bool gather_revalidate(struct host1x_gather_decode *dec)
+{
+    const uint32_t *buf;
+    uint32_t hash;
+    hwaddr len = dec->count << 2;
+
+    gather_clear_dirty(dec);
+
+    buf = address_space_map(&address_space_memory, dec->addr, &len, false,
+                            MEMTXATTRS_UNSPECIFIED);
+    if (!buf)
+        return false;
+
+    hash = len == (dec->count << 2) ? crc32c(0xffffffff, (const uint8_t *) buf,
+                                             len) : ~dec->hash;
+    address_space_unmap(&address_space_memory, (void *) buf, len, false, 0);
+
+    return hash == dec->hash;
+}
+
+static void gather_cache_remove(struct host1x_cdma *cdma,
+                                struct host1x_gather_decode *dec)
+{
+    QTAILQ_REMOVE(&cdma->gather_lru, dec, lru);
+    g_hash_table_remove(cdma->gather_cache, &dec->addr);
+}
+
+/*
+ * Looks up the decode of a non-insert gather, decoding it if needed.  Called
+ * with the BQL held since dirty logging may have to be enabled.
+ */
+struct host1x_gather_decode *
+host1x_gather_cache_lookup(struct host1x_cdma *cdma, hwaddr addr,
+                           uint32_t count)
+{
+    struct host1x_gather_decode *dec;
+    const uint32_t *buf;
+    hwaddr len;
+
+    dec = g_hash_table_lookup(cdma->gather_cache, &addr);
+
+    if (dec) {
+        if (dec->count == count && dec->start_module == cdma->module) {
+            if (gather_is_clean(dec)) {
+                /* Nothing cleared its pages since, it is valid as of now.  */
+                dec->gen = gather_gen;
+                goto hit;
+            }
+
+            /* Rewritten, but most likely with the very same commands.  */
+            if (gather_revalidate(dec))
+                goto hit;
+        }
+
+        gather_cache_remove(cdma, dec);
+    }
+
+    if (g_hash_table_size(cdma->gather_cache) >= GATHER_CACHE_SIZE)
+        gather_cache_remove(cdma, QTAILQ_FIRST(&cdma->gather_lru));
+
+    dec = g_new0(struct host1x_gather_decode, 1);
+    dec->addr = addr;
+    dec->count = count;
+    dec->start_module = cdma->module;
+
+    buf = gather_map(dec, &len);
+    if (!buf)
+        goto fail;
+
+    if (len < (count << 2)) {
+        address_space_unmap(&address_space_memory, (void *) buf, len, false, 0);
+        goto fail;
+    }
+
+    /* Clear before reading, so that a following write isn't lost.  */
+    gather_clear_dirty(dec);
+
+    dec->hash = crc32c(0xffffffff, (const uint8_t *) buf, count << 2);
+
+    if (!gather_decode(dec, buf, count)) {
+        address_space_unmap(&address_space_memory, (void *) buf, len, false, 0);
+        goto fail;
+    }
+
+    address_space_unmap(&address_space_memory, (void *) buf, len, false, 0);
+
+    g_hash_table_insert(cdma->gather_cache, &dec->addr, dec);
+    QTAILQ_INSERT_TAIL(&cdma->gather_lru, dec, lru);
+
+    return dec;
+
+hit:
+    QTAILQ_REMOVE(&cdma->gather_lru, dec, lru);
+    QTAILQ_INSERT_TAIL(&cdma->gather_lru, dec, lru);
+
+    return dec;
+
+fail:
+    g_free(dec);
+
+    return NULL;
+}
+
+void host1x_gather_cache_init(struct host1x_cdma *cdma)
+{
+    if (!gather_page_gens) {
+        gather_page_gens = g_hash_table_new(g_direct_hash, g_direct_equal);
+        gather_cdmas = g_ptr_array_new();
+    }
+
+    cdma->gather_cache = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                               NULL, gather_decode_free);
+    QTAILQ_INIT(&cdma->gather_lru);
+    g_ptr_array_add(gather_cdmas, cdma);
+}
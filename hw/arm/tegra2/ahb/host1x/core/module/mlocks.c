@@ -19,50 +19,121 @@
 
 #include "tegra_common.h"
 
+#include "block/aio.h"
+#include "qemu/coroutine.h"
+#include "qemu/stats64.h"
+#include "qemu/timer.h"
 
 #include "host1x_cdma.h"
 #include "host1x_module.h"
 #include "host1x_priv.h"
 
-typedef union host1x_mlock {
-    struct {
-        unsigned int ch_owns:1;
-        unsigned int cpu_owns:1;
-        unsigned int undefined_bits_1:5;
-        unsigned int owner_chid:4;
-        unsigned int undefined_bits_2:20;
-        QemuMutex mutex;
-        QemuCond release_cond;
-    };
-
-    uint32_t reg32;
+/*
+ * The whole lock state is the MLOCK_OWNER register image, changed with CAS
+ * only.  Channels blocked on a lock mark themselves in the waiting mask and
+ * yield, the one who changes the state wakes up the marked channels of that
+ * lock only.  CPU acquire is a try-lock polled by the guest, fairness
+ * counters tell when either side keeps losing the lock to the other.
+ */
+
+#define MLOCK_CH_OWNS       (1 << 0)
+#define MLOCK_CPU_OWNS      (1 << 1)
+#define MLOCK_OWNER_SHIFT   7
+#define MLOCK_OWNER_MASK    (0xf << MLOCK_OWNER_SHIFT)
+
+#define MLOCK_OWNER(state)  (((state) & MLOCK_OWNER_MASK) >> MLOCK_OWNER_SHIFT)
+
+/* Failed CPU acquires in a row / channel wait time to report starvation.  */
+#define MLOCK_CPU_STARVED       100000
+#define MLOCK_CH_STARVED_NS     (1000 * SCALE_MS)
+
+typedef struct host1x_mlock {
+    uint32_t state;
+    uint32_t waiting;
+    Coroutine *waiters[16];
+
+    Stat64 cpu_acquired;
+    Stat64 cpu_contended;
+    Stat64 ch_acquired;
+    Stat64 ch_contended;
+    uint32_t cpu_fails;     /* Failed CPU acquires since the last success */
 } host1x_mlock;
 
 static host1x_mlock mlocks[NV_HOST1X_NB_MLOCKS];
 
+static void host1x_mlock_wake(host1x_mlock *mlock)
+{
+    uint32_t waiting = qatomic_xchg(&mlock->waiting, 0);
+    int i;
+
+    FOREACH_BIT_SET(waiting, i, 16) {
+        aio_co_wake(mlock->waiters[i]);
+    }
+}
+
+/*
+ * Yields until the lock state changes from @state, returns right away if it
+ * has changed already.  Pairs with host1x_mlock_wake().
+ */
+static void coroutine_fn host1x_mlock_wait(host1x_mlock *mlock,
+                                           struct host1x_cdma *cdma,
+                                           uint32_t state)
+{
+    uint32_t bit = 1 << cdma->ch_id;
+
+    mlock->waiters[cdma->ch_id] = qemu_coroutine_self();
+    qatomic_or(&mlock->waiting, bit);
+
+    if (qatomic_read(&mlock->state) == state && cdma->enabled) {
+        host1x_cdma_yield();
+        return;
+    }
+
+    /* Waker took the bit already, consume its wakeup.  */
+    if (!(qatomic_fetch_and(&mlock->waiting, ~bit) & bit))
+        host1x_cdma_yield();
+}
+
 uint32_t host1x_cpu_get_mlock_val(uint32_t id)
 {
     host1x_mlock *mlock = &mlocks[id];
 
     g_assert(id < NV_HOST1X_NB_MLOCKS);
 
-    return mlock->reg32;
+    return qatomic_read(&mlock->state);
 }
 
 uint32_t host1x_cpu_acquire_mlock(uint32_t id)
 {
     host1x_mlock *mlock = &mlocks[id];
+    uint32_t state;
 
     g_assert(id < NV_HOST1X_NB_MLOCKS);
 
-    qemu_mutex_lock(&mlock->mutex);
-
-    if (!mlock->ch_owns)
-        mlock->cpu_owns = 1;
-
-    qemu_mutex_unlock(&mlock->mutex);
-
-    return !mlock->cpu_owns;
+    do {
+        state = qatomic_read(&mlock->state);
+
+        if (state & MLOCK_CH_OWNS) {
+            stat64_add(&mlock->cpu_contended, 1);
+
+            if (qatomic_inc_fetch(&mlock->cpu_fails) == MLOCK_CPU_STARVED)
+                TPRINT("%s: mlock%u CPU starved, owner channel %u, "
+                       "CPU %" PRIu64 "/%" PRIu64 " channels %" PRIu64
+                       "/%" PRIu64 " acquired/contended\n",
+                       __func__, id, MLOCK_OWNER(state),
+                       stat64_get(&mlock->cpu_acquired),
+                       stat64_get(&mlock->cpu_contended),
+                       stat64_get(&mlock->ch_acquired),
+                       stat64_get(&mlock->ch_contended));
+            return 1;
+        }
+    } while (qatomic_cmpxchg(&mlock->state, state,
+                             state | MLOCK_CPU_OWNS) != state);
+
+    stat64_add(&mlock->cpu_acquired, 1);
+    qatomic_set(&mlock->cpu_fails, 0);
+
+    return 0;
 }
 
 void host1x_cpu_release_mlock(uint32_t id)
@@ -71,81 +142,116 @@ void host1x_cpu_release_mlock(uint32_t id)
 
     g_assert(id < NV_HOST1X_NB_MLOCKS);
 
-    qemu_mutex_lock(&mlock->mutex);
-
-    mlock->ch_owns = 0;
-    mlock->cpu_owns = 0;
-    qemu_cond_signal(&mlock->release_cond);
-
-    qemu_mutex_unlock(&mlock->mutex);
+    qatomic_and(&mlock->state, ~(MLOCK_CH_OWNS | MLOCK_CPU_OWNS));
+    host1x_mlock_wake(mlock);
 }
 
-void host1x_ch_acquire_mlock(struct host1x_cdma *cdma, uint32_t id)
+/*
+ * Called from the channel coroutine without the BQL, a blocked channel
+ * yields to the other channels.  Stopped channel takes the lock regardless.
+ */
+void coroutine_fn host1x_ch_acquire_mlock(struct host1x_cdma *cdma,
+                                          uint32_t id)
 {
     host1x_mlock *mlock = &mlocks[id];
+    uint32_t state, owned;
+    int64_t start = 0;
 
     g_assert(id < NV_HOST1X_NB_MLOCKS);
 
-    qemu_mutex_lock(&mlock->mutex);
+    for (;;) {
+        state = qatomic_read(&mlock->state);
+
+        if (!(state & (MLOCK_CH_OWNS | MLOCK_CPU_OWNS)) || !cdma->enabled) {
+            owned = (state & ~MLOCK_OWNER_MASK) | MLOCK_CH_OWNS |
+                    (cdma->ch_id << MLOCK_OWNER_SHIFT);
 
-    while ((mlock->cpu_owns || mlock->ch_owns) && cdma->enabled)
-        qemu_cond_wait(&mlock->release_cond, &mlock->mutex);
+            if (qatomic_cmpxchg(&mlock->state, state, owned) == state)
+                break;
+            continue;
+        }
 
-    mlock->owner_chid = cdma->ch_id;
-    mlock->ch_owns = 1;
+        if (!start) {
+            start = get_clock();
+            stat64_add(&mlock->ch_contended, 1);
+        }
 
-    qemu_mutex_unlock(&mlock->mutex);
+        host1x_mlock_wait(mlock, cdma, state);
+    }
+
+    stat64_add(&mlock->ch_acquired, 1);
+
+    if (start) {
+        int64_t waited = get_clock() - start;
+
+        stat64_add(&cdma->stats.mlock_wait_ns, waited);
+
+        if (waited >= MLOCK_CH_STARVED_NS)
+            TPRINT("%s: mlock%u channel %u starved for %" PRId64 " ms\n",
+                   __func__, id, cdma->ch_id, waited / SCALE_MS);
+    }
 }
 
-void host1x_ch_release_mlock(struct host1x_cdma *cdma, uint32_t id)
+void coroutine_fn host1x_ch_release_mlock(struct host1x_cdma *cdma,
+                                          uint32_t id)
 {
     host1x_mlock *mlock = &mlocks[id];
+    uint32_t state;
 
     g_assert(id < NV_HOST1X_NB_MLOCKS);
 
-    qemu_mutex_lock(&mlock->mutex);
+    for (;;) {
+        state = qatomic_read(&mlock->state);
 
-    while (cdma->enabled &&
-                (mlock->cpu_owns ||
-                        (mlock->ch_owns && mlock->owner_chid != cdma->ch_id)))
-        qemu_cond_wait(&mlock->release_cond, &mlock->mutex);
+        if (cdma->enabled && ((state & MLOCK_CPU_OWNS) ||
+                              ((state & MLOCK_CH_OWNS) &&
+                               MLOCK_OWNER(state) != cdma->ch_id))) {
+            host1x_mlock_wait(mlock, cdma, state);
+            continue;
+        }
 
-    mlock->ch_owns = 0;
-    qemu_cond_signal(&mlock->release_cond);
+        if (qatomic_cmpxchg(&mlock->state, state,
+                            state & ~MLOCK_CH_OWNS) == state)
+            break;
+    }
 
-    qemu_mutex_unlock(&mlock->mutex);
+    host1x_mlock_wake(mlock);
 }
 
-void host1x_wake_mlocked_channels(void)
+/* Kicks the stopped channel out of a lock wait.  */
+void host1x_wake_mlocked_channel(struct host1x_cdma *cdma)
 {
+    uint32_t bit = 1 << cdma->ch_id;
     host1x_mlock *mlock;
     int i;
 
     for (i = 0; i < NV_HOST1X_NB_MLOCKS; i++) {
         mlock = &mlocks[i];
 
-        qemu_mutex_lock(&mlock->mutex);
-
-        qemu_cond_signal(&mlock->release_cond);
-
-        qemu_mutex_unlock(&mlock->mutex);
+        if (qatomic_fetch_and(&mlock->waiting, ~bit) & bit)
+            aio_co_wake(mlock->waiters[cdma->ch_id]);
     }
 }
 
 void host1x_reset_mlocks(void)
 {
+    host1x_mlock *mlock;
     int i;
 
-    for (i = 0; i < NV_HOST1X_NB_MLOCKS; i++)
-        mlocks[i].reg32 = 0;
+    for (i = 0; i < NV_HOST1X_NB_MLOCKS; i++) {
+        mlock = &mlocks[i];
+
+        qatomic_set(&mlock->state, 0);
+        qatomic_set(&mlock->cpu_fails, 0);
+        stat64_init(&mlock->cpu_acquired, 0);
+        stat64_init(&mlock->cpu_contended, 0);
+        stat64_init(&mlock->ch_acquired, 0);
+        stat64_init(&mlock->ch_contended, 0);
+        host1x_mlock_wake(mlock);
+    }
 }
 
 void host1x_init_mlocks(void)
 {
-    int i;
-
-    for (i = 0; i < NV_HOST1X_NB_MLOCKS; i++) {
-        qemu_mutex_init(&mlocks[i].mutex);
-        qemu_cond_init(&mlocks[i].release_cond);
-    }
+    host1x_reset_mlocks();
 }
@@ -20,6 +20,7 @@
 #include "tegra_common.h"
 
 #include "hw/hw.h"
+#include "qemu/main-loop.h"
 
 #include "host1x_syncpts.h"
 #include "tegra_cpu.h"
@@ -38,18 +39,64 @@ static qemu_irq *cop_syncpts_irq;
 
 static QemuMutex irq_mutex;
 
+/*
+ * Threshold crossings are collected from any thread and latched into the
+ * status registers by a bottom half, that raises the IRQ lines once for
+ * the whole batch.  Status readers latch them first, so the guest never
+ * sees a crossed threshold without its status bit.  Destination mask
+ * updates latch them too, under the same lock, so that crossings are
+ * routed with the mask that was in force when they happened.
+ */
+static uint32_t syncpts_irq_pending;
+static QEMUBH *syncpts_irq_bh;
+
+static void host1x_set_irq_status_bit(enum hcpu cpu_id, bool enable);
+
+static void host1x_latch_syncpts_irq_locked(void)
+{
+    uint32_t pending = qatomic_xchg(&syncpts_irq_pending, 0);
+    enum hcpu cpu_id;
+
+    if (!pending)
+        return;
+
+    FOREACH_CPU(cpu_id) {
+        uint32_t irq_mask = pending & syncpts_percpu_dst_mask[cpu_id];
+
+        if (irq_mask) {
+            syncpts_percpu_irq_sts[cpu_id] |= irq_mask;
+            host1x_set_irq_status_bit(cpu_id, 1);
+        }
+    }
+}
+
+static void host1x_latch_syncpts_irq(void)
+{
+    lock_irqs();
+    host1x_latch_syncpts_irq_locked();
+    unlock_irqs();
+}
+
+static void host1x_syncpts_irq_bh(void *opaque)
+{
+    host1x_latch_syncpts_irq();
+}
+
 inline uint32_t host1x_get_syncpts_irq_status(void)
 {
+    host1x_latch_syncpts_irq();
     return syncpts_irq_sts;
 }
 
 inline uint32_t host1x_get_syncpts_cpu_irq_status(void)
 {
+    host1x_latch_syncpts_irq();
     return syncpts_percpu_irq_sts[HOST1X_CPU];
 }
 
 inline uint32_t host1x_get_syncpts_cop_irq_status(void)
 {
+    host1x_latch_syncpts_irq();
     return syncpts_percpu_irq_sts[HOST1X_COP];
 }
 
@@ -119,6 +166,8 @@ void host1x_enable_syncpts_irq_mask(enum hcpu cpu_id, uint32_t enable_mask)
 
     lock_irqs();
 
+    host1x_latch_syncpts_irq_locked();
+
     FOREACH_CPU(cpu) {
         if (cpu == cpu_id) {
             syncpts_percpu_dst_mask[cpu] |= enable_mask;
@@ -134,6 +183,8 @@ void host1x_enable_syncpts_irq_mask(enum hcpu cpu_id, uint32_t enable_mask)
             host1x_set_syncpt_irq(i);
         }
     }
+
+    host1x_latch_syncpts_irq();
 }
 
 void host1x_set_syncpts_irq_dst_mask(int part, uint32_t mask)
@@ -144,6 +195,8 @@ void host1x_set_syncpts_irq_dst_mask(int part, uint32_t mask)
 
     lock_irqs();
 
+    host1x_latch_syncpts_irq_locked();
+
     FOREACH_BIT_SET(mask, i, NV_HOST1X_SYNCPT_NB_PTS) {
         cpu_id = ((1 << i) & 0x55555555) ? HOST1X_CPU : HOST1X_COP;
         dst_mask = 1 << ((i - cpu_id) / 2);
@@ -158,6 +211,8 @@ void host1x_clear_syncpts_irq_dst_mask(uint32_t clear_mask)
 {
     lock_irqs();
 
+    host1x_latch_syncpts_irq_locked();
+
     syncpts_percpu_dst_mask[HOST1X_CPU] &= ~clear_mask;
     syncpts_percpu_dst_mask[HOST1X_COP] &= ~clear_mask;
 
@@ -166,25 +221,16 @@ void host1x_clear_syncpts_irq_dst_mask(uint32_t clear_mask)
 
 void host1x_set_syncpt_irq(uint8_t syncpt_id)
 {
-    uint32_t irq_mask = 1 << syncpt_id;
-    enum hcpu cpu_id;
-
-    lock_irqs();
-
-    FOREACH_CPU(cpu_id) {
-        if (syncpts_percpu_dst_mask[cpu_id] & irq_mask) {
-            syncpts_percpu_irq_sts[cpu_id] |= irq_mask;
-            host1x_set_irq_status_bit(cpu_id, 1);
-        }
-    }
-
-    unlock_irqs();
+    qatomic_or(&syncpts_irq_pending, 1 << syncpt_id);
+    qemu_bh_schedule(syncpts_irq_bh);
 }
 
 void host1x_clear_syncpts_irq_status(enum hcpu cpu_id, uint32_t clear_mask)
 {
     unsigned i;
 
+    host1x_latch_syncpts_irq();
+
     lock_irqs();
 
     FOREACH_BIT_SET(clear_mask, i, NV_HOST1X_SYNCPT_NB_PTS) {
@@ -210,6 +256,7 @@ void host1x_clear_syncpts_irq_status(enum hcpu cpu_id, uint32_t clear_mask)
 void host1x_init_syncpts_irq(qemu_irq *cpu_irq, qemu_irq *cop_irq)
 {
     qemu_mutex_init(&irq_mutex);
+    syncpts_irq_bh = qemu_bh_new(host1x_syncpts_irq_bh, NULL);
 
     cpu_syncpts_irq = cpu_irq;
     cop_syncpts_irq = cop_irq;
@@ -220,6 +267,7 @@ void host1x_reset_syncpt_irqs(void)
     enum hcpu cpu_id;
 
     syncpts_irq_sts = 0;
+    qatomic_set(&syncpts_irq_pending, 0);
 
     FOREACH_CPU(cpu_id) {
         syncpts_percpu_irq_sts[cpu_id] = 0;
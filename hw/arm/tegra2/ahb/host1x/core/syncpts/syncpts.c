@@ -24,7 +24,6 @@
 #include "syncpts.h"
 
 enum stype {
-    COUNTER_INCR,
     COUNTER_CHANGE,
     THRESHOLD_CHANGE,
 };
@@ -50,33 +49,24 @@ int counter_reached_threshold(uint32_t counter, uint32_t threshold)
 static void handle_syncpt_update(uint32_t id, enum stype op, uint32_t val)
 {
     struct host1x_syncpt *syncpt = &syncpts[id];
-    struct host1x_syncpt_waiter *waiter, *waiter_next;
 
     assert(id < NV_HOST1X_SYNCPT_NB_PTS);
 
     syncpt_lock(syncpt);
 
     switch (op) {
-    case COUNTER_INCR:
-        syncpt->counter++;
-
-        QLIST_FOREACH_SAFE(waiter, &syncpt->waiters_incr, next, waiter_next) {
-            host1x_unlock_syncpt_waiter(waiter);
-        }
-        break;
     case COUNTER_CHANGE:
-        syncpt->counter = val;
+        qatomic_set(&syncpt->counter, val);
+        host1x_requeue_threshold_waiters(syncpt);
         break;
     case THRESHOLD_CHANGE:
-        syncpt->threshold = val;
+        qatomic_set(&syncpt->threshold, val & SYNCPT_THRESH_MASK);
         break;
     };
 
-    if (counter_reached_threshold(syncpt->counter, syncpt->threshold))
+    if (host1x_syncpt_threshold_is_crossed(id))
         host1x_set_syncpt_irq(id);
 
-    host1x_update_threshold_waiters(syncpt);
-
     syncpt_unlock(syncpt);
 }
 
@@ -90,10 +80,10 @@ static void handle_base_update(uint32_t id, enum btype op, uint32_t val)
 
     switch (op) {
     case BASE_INCR:
-        syncpt_base->base += val;
+        qatomic_set(&syncpt_base->base, syncpt_base->base + val);
         break;
     case BASE_CHANGE:
-        syncpt_base->base = val;
+        qatomic_set(&syncpt_base->base, val);
         break;
     };
 
@@ -102,9 +92,33 @@ static void handle_base_update(uint32_t id, enum btype op, uint32_t val)
     syncpt_unlock(syncpt_base);
 }
 
+/* Lockless unless somebody waits for the syncpoint.  */
 void host1x_incr_syncpt(uint32_t syncpt_id)
 {
-    handle_syncpt_update(syncpt_id, COUNTER_INCR, 0);
+    struct host1x_syncpt *syncpt = &syncpts[syncpt_id];
+    struct host1x_syncpt_waiter *waiter, *waiter_next;
+    uint32_t counter;
+
+    assert(syncpt_id < NV_HOST1X_SYNCPT_NB_PTS);
+
+    /* Full barrier, pairs with host1x_queue_threshold_waiter().  */
+    counter = qatomic_inc_fetch(&syncpt->counter);
+
+    if (counter_reached_threshold(counter, qatomic_read(&syncpt->threshold)))
+        host1x_set_syncpt_irq(syncpt_id);
+
+    if (!qatomic_read(&syncpt->nr_waiters))
+        return;
+
+    syncpt_lock(syncpt);
+
+    QLIST_FOREACH_SAFE(waiter, &syncpt->waiters_incr, next, waiter_next) {
+        host1x_unlock_syncpt_waiter(waiter);
+    }
+
+    host1x_update_threshold_waiters(syncpt);
+
+    syncpt_unlock(syncpt);
 }
 
 void host1x_set_syncpt_count(uint32_t syncpt_id, uint32_t val)
@@ -127,31 +141,33 @@ void host1x_set_syncpt_base(uint32_t syncpt_base_id, uint32_t val)
     handle_base_update(syncpt_base_id, BASE_CHANGE, val);
 }
 
-/* WARNING: Assumed atomic change.  */
+/* Orders the reads of whatever was done before the increment.  */
 uint32_t host1x_get_syncpt_count(uint32_t syncpt_id)
 {
     assert(syncpt_id < NV_HOST1X_SYNCPT_NB_PTS);
-    return syncpts[syncpt_id].counter;
+    return qatomic_load_acquire(&syncpts[syncpt_id].counter);
 }
 
 uint32_t host1x_get_syncpt_threshold(uint32_t syncpt_id)
 {
     assert(syncpt_id < NV_HOST1X_SYNCPT_NB_PTS);
-    return syncpts[syncpt_id].threshold;
+    return qatomic_read(&syncpts[syncpt_id].threshold);
 }
 
 uint32_t host1x_get_syncpt_base(uint32_t syncpt_base_id)
 {
     assert(syncpt_base_id < NV_HOST1X_SYNCPT_NB_BASES);
-    return syncpt_bases[syncpt_base_id].base;
+    return qatomic_read(&syncpt_bases[syncpt_base_id].base);
 }
 
 void host1x_init_syncpts(void)
 {
     int i;
 
-    for (i = 0; i < NV_HOST1X_SYNCPT_NB_PTS; i++)
+    for (i = 0; i < NV_HOST1X_SYNCPT_NB_PTS; i++) {
         qemu_mutex_init(&syncpts[i].mutex);
+        qemu_cond_init(&syncpts[i].cond);
+    }
 
     for (i = 0; i < NV_HOST1X_SYNCPT_NB_BASES; i++)
         qemu_mutex_init(&syncpt_bases[i].mutex);
@@ -165,13 +181,14 @@ void host1x_reset_syncpts(void)
     for (i = 0; i < NV_HOST1X_SYNCPT_NB_PTS; i++) {
         syncpts[i].counter = 0;
         syncpts[i].threshold = 0;
+        syncpts[i].nr_waiters = 0;
         QLIST_INIT(&syncpts[i].waiters);
-        QLIST_INIT(&syncpts[i].waiters_base);
         QLIST_INIT(&syncpts[i].waiters_incr);
     }
 
     for (i = 0; i < NV_HOST1X_SYNCPT_NB_BASES; i++) {
         syncpt_bases[i].base = 0;
+        QLIST_INIT(&syncpt_bases[i].waiters);
     }
 }
 
@@ -181,5 +198,6 @@ int host1x_syncpt_threshold_is_crossed(uint32_t syncpt_id)
 
     assert(syncpt_id < NV_HOST1X_SYNCPT_NB_PTS);
 
-    return counter_reached_threshold(syncpt->counter, syncpt->threshold);
+    return counter_reached_threshold(qatomic_read(&syncpt->counter),
+                                     qatomic_read(&syncpt->threshold));
 }
@@ -27,17 +27,27 @@
 #define syncpt_lock(s)      qemu_mutex_lock(&s->mutex)
 #define syncpt_unlock(s)    qemu_mutex_unlock(&s->mutex)
 
+#define SYNCPT_THRESH_MASK  ((1 << NV_HOST1X_SYNCPT_THESH_WIDTH) - 1)
+
+/*
+ * Counter and threshold are accessed atomically, the mutex protects the
+ * waiter lists.  Waiters sleep on the syncpoint condition.
+ */
 struct host1x_syncpt {
     uint32_t counter;
-    unsigned int threshold:NV_HOST1X_SYNCPT_THESH_WIDTH;
+    uint32_t threshold;
+    unsigned int nr_waiters;
+    /* Threshold waiters, sorted by the counter value they wait for.  */
     QLIST_HEAD(, host1x_syncpt_waiter) waiters;
-    QLIST_HEAD(, host1x_syncpt_waiter) waiters_base;
     QLIST_HEAD(, host1x_syncpt_waiter) waiters_incr;
+    QemuCond cond;
     QemuMutex mutex;
 };
 
 struct host1x_syncpt_base {
     uint32_t base;
+    /* Base waiters queued on any syncpoint, protected by the base lock.  */
+    QLIST_HEAD(, host1x_syncpt_waiter) waiters;
     QemuMutex mutex;
 };
 
@@ -46,6 +56,7 @@ extern struct host1x_syncpt_base syncpt_bases[];
 
 int counter_reached_threshold(uint32_t counter, uint32_t threshold);
 void host1x_update_threshold_waiters(struct host1x_syncpt *syncpt);
+void host1x_requeue_threshold_waiters(struct host1x_syncpt *syncpt);
 void host1x_update_threshold_waiters_base(uint32_t syncpt_base_id);
 
 #endif // HOST1X_CORE_SYNCPTS_H
@@ -21,82 +21,172 @@
 
 #include "qemu/main-loop.h"
 
+#include "host1x_cdma.h"
 #include "host1x_syncpts.h"
 #include "syncpts.h"
+/*
+ * Threshold waiters are kept sorted by the counter value that satisfies
+ * them, so a counter increment only has to look at the head of the list.
+ * The value is resolved from the 16-bit HW comparison when the waiter is
+ * queued; an unsatisfied waiter is at most 2^15 increments away, hence the
+ * distance from the current counter orders the list unambiguously.  Waiters
+ * are requeued when the counter or their base is set to an arbitrary value,
+ * base waiters are additionally linked into a list of their base for that.
+ *
+ * The counter is incremented without the lock, the incrementer takes it
+ * only if nr_waiters is non-zero.  A waiter is accounted before it samples
+ * the counter, so either the waiter sees the increment or the incrementer
+ * sees the waiter.  The waiter pointer to the syncpoint is cleared on wake
+ * up.  Channel coroutines yield and are re-entered on wake up, waits issued
+ * by vCPUs (indirect host1x module writes) use a waiter on the vCPU stack
+ * and sleep on the syncpoint condition with the BQL dropped, so that the
+ * channels can go on incrementing.
+ */
 
 void host1x_init_syncpt_waiter(struct host1x_syncpt_waiter *waiter)
 {
-    qemu_event_init(&waiter->syncpt_ev, 1);
+    waiter->syncpt = NULL;
+}
+
+static void host1x_wake_syncpt_waiter(struct host1x_syncpt *syncpt,
+                                      struct host1x_syncpt_waiter *waiter)
+{
+    qatomic_dec(&syncpt->nr_waiters);
+    qatomic_set(&waiter->syncpt, NULL);
+
+    if (waiter->co)
+        aio_co_wake(waiter->co);
+    else
+        qemu_cond_broadcast(&syncpt->cond);
 }
 
 void host1x_unlock_syncpt_waiter(struct host1x_syncpt_waiter *waiter)
 {
     QLIST_REMOVE(waiter, next);
-    qemu_event_set(&waiter->syncpt_ev);
+    host1x_wake_syncpt_waiter(waiter->syncpt, waiter);
 }
 
 void host1x_unlock_syncpt_waiter_forced(struct host1x_syncpt_waiter *waiter)
 {
-    struct host1x_syncpt_waiter *waiter__, *waiter_next;
-    int i;
+    struct host1x_syncpt *syncpt = qatomic_read(&waiter->syncpt);
 
-    for (i = 0; i < NV_HOST1X_SYNCPT_NB_PTS; i++) {
-        struct host1x_syncpt *syncpt = &syncpts[i];
+    if (!syncpt)
+        return;
 
-        qemu_mutex_lock(&syncpt->mutex);
+    syncpt_lock(syncpt);
 
-        QLIST_FOREACH_SAFE(waiter__, &syncpt->waiters, next, waiter_next) {
-            if (waiter != waiter__)
-                continue;
+    /* Could be woken up meanwhile.  */
+    if (waiter->syncpt == syncpt)
+        host1x_unlock_syncpt_waiter(waiter);
 
-            host1x_unlock_syncpt_waiter(waiter);
-            qemu_mutex_unlock(&syncpt->mutex);
-            return;
-        }
+    syncpt_unlock(syncpt);
+}
 
-        QLIST_FOREACH_SAFE(waiter__, &syncpt->waiters_base, next, waiter_next) {
-            if (waiter != waiter__)
-                continue;
+/*
+ * Called with the syncpoint locked, returns with the BQL locked.  A channel
+ * can't be re-entered before it yields as all channels run on one thread.
+ */
+static void host1x_sleep_syncpt_waiter(struct host1x_syncpt *syncpt,
+                                       struct host1x_syncpt_waiter *waiter)
+{
+    if (waiter->co) {
+        syncpt_unlock(syncpt);
+        qemu_mutex_unlock_iothread();
+        host1x_cdma_yield();
+        qemu_mutex_lock_iothread();
+        return;
+    }
 
-            host1x_unlock_syncpt_waiter(waiter);
-            qemu_mutex_unlock(&syncpt->mutex);
-            return;
-        }
+    qemu_mutex_unlock_iothread();
 
-        QLIST_FOREACH_SAFE(waiter__, &syncpt->waiters_incr, next, waiter_next) {
-            if (waiter != waiter__)
-                continue;
+    while (waiter->syncpt == syncpt)
+        qemu_cond_wait(&syncpt->cond, &syncpt->mutex);
 
-            host1x_unlock_syncpt_waiter(waiter);
-            qemu_mutex_unlock(&syncpt->mutex);
-            return;
-        }
+    syncpt_unlock(syncpt);
+
+    qemu_mutex_lock_iothread();
+}
+
+static bool waiter_reached(struct host1x_syncpt_waiter *waiter,
+                           uint32_t counter)
+{
+    return (int32_t)(waiter->wake_at - counter) <= 0;
+}
+
+/*
+ * Returns false if the threshold is reached already.  A requeued waiter
+ * stays accounted in nr_waiters until it is woken up.
+ */
+static bool host1x_queue_threshold_waiter(struct host1x_syncpt *syncpt,
+                                          struct host1x_syncpt_waiter *waiter,
+                                          bool requeue)
+{
+    struct host1x_syncpt_waiter *pos, *last = NULL;
+    uint32_t threshold = waiter->threshold;
+    uint32_t counter;
+
+    if (waiter->base)
+        threshold += qatomic_read(&syncpt_bases[waiter->base_id].base);
+
+    if (!requeue)
+        qatomic_inc(&syncpt->nr_waiters);
+
+    counter = qatomic_read(&syncpt->counter);
+
+    if (counter_reached_threshold(counter, threshold)) {
+        if (!requeue)
+            qatomic_dec(&syncpt->nr_waiters);
+        return false;
+    }
 
-        qemu_mutex_unlock(&syncpt->mutex);
+    waiter->wake_at = counter + ((threshold - counter) & SYNCPT_THRESH_MASK);
+
+    QLIST_FOREACH(pos, &syncpt->waiters, next) {
+        if ((int32_t)(pos->wake_at - waiter->wake_at) > 0) {
+            QLIST_INSERT_BEFORE(pos, waiter, next);
+            goto out;
+        }
+        last = pos;
     }
+
+    if (last)
+        QLIST_INSERT_AFTER(last, waiter, next);
+    else
+        QLIST_INSERT_HEAD(&syncpt->waiters, waiter, next);
+out:
+    qatomic_set(&waiter->syncpt, syncpt);
+
+    return true;
 }
 
+/* Counter has been incremented, possibly several times.  */
 void host1x_update_threshold_waiters(struct host1x_syncpt *syncpt)
 {
-    struct host1x_syncpt_waiter *waiter, *waiter_next;
+    uint32_t counter = qatomic_read(&syncpt->counter);
+    struct host1x_syncpt_waiter *waiter;
 
-    QLIST_FOREACH_SAFE(waiter, &syncpt->waiters, next, waiter_next) {
-        if (counter_reached_threshold(syncpt->counter, waiter->threshold))
-            host1x_unlock_syncpt_waiter(waiter);
-    }
+    while ((waiter = QLIST_FIRST(&syncpt->waiters)) != NULL) {
+        if (!waiter_reached(waiter, counter))
+            break;
 
-    QLIST_FOREACH_SAFE(waiter, &syncpt->waiters_base, next, waiter_next) {
-        struct host1x_syncpt_base *syncpt_base = &syncpt_bases[waiter->base_id];
-        uint32_t threshold;
+        host1x_unlock_syncpt_waiter(waiter);
+    }
+}
 
-        syncpt_lock(syncpt_base);
+/* Counter has been set to an arbitrary value.  */
+void host1x_requeue_threshold_waiters(struct host1x_syncpt *syncpt)
+{
+    QLIST_HEAD(, host1x_syncpt_waiter) requeue =
+                                        QLIST_HEAD_INITIALIZER(requeue);
+    struct host1x_syncpt_waiter *waiter;
 
-        threshold = syncpt_base->base + waiter->threshold;
+    QLIST_SWAP(&requeue, &syncpt->waiters, next);
 
-        if (counter_reached_threshold(syncpt->counter, threshold))
-            host1x_unlock_syncpt_waiter(waiter);
+    while ((waiter = QLIST_FIRST(&requeue)) != NULL) {
+        QLIST_REMOVE(waiter, next);
 
-        syncpt_unlock(syncpt_base);
+        if (!host1x_queue_threshold_waiter(syncpt, waiter, true))
+            host1x_wake_syncpt_waiter(syncpt, waiter);
     }
 }
 
@@ -110,17 +200,15 @@ void host1x_wait_syncpt(struct host1x_syncpt_waiter *waiter,
     syncpt_lock(syncpt);
 
     waiter->threshold = threshold;
+    waiter->base = false;
+    waiter->co = qemu_in_coroutine() ? qemu_coroutine_self() : NULL;
 
-    if (!counter_reached_threshold(syncpt->counter, waiter->threshold)) {
-        QLIST_INSERT_HEAD(&syncpt->waiters, waiter, next);
-        qemu_event_reset(&waiter->syncpt_ev);
+    if (!host1x_queue_threshold_waiter(syncpt, waiter, false)) {
+        syncpt_unlock(syncpt);
+        return;
     }
 
-    syncpt_unlock(syncpt);
-
-    qemu_mutex_unlock_iothread();
-    qemu_event_wait(&waiter->syncpt_ev);
-    qemu_mutex_lock_iothread();
+    host1x_sleep_syncpt_waiter(syncpt, waiter);
 }
 
 void host1x_wait_syncpt_incr(struct host1x_syncpt_waiter *waiter,
@@ -132,73 +220,75 @@ void host1x_wait_syncpt_incr(struct host1x_syncpt_waiter *waiter,
 
     syncpt_lock(syncpt);
 
-    QLIST_INSERT_HEAD(&syncpt->waiters_incr, waiter, next);
-    qemu_event_reset(&waiter->syncpt_ev);
+    waiter->co = qemu_in_coroutine() ? qemu_coroutine_self() : NULL;
 
-    syncpt_unlock(syncpt);
+    QLIST_INSERT_HEAD(&syncpt->waiters_incr, waiter, next);
+    qatomic_set(&waiter->syncpt, syncpt);
+    qatomic_inc(&syncpt->nr_waiters);
 
-    qemu_mutex_unlock_iothread();
-    qemu_event_wait(&waiter->syncpt_ev);
-    qemu_mutex_lock_iothread();
+    host1x_sleep_syncpt_waiter(syncpt, waiter);
 }
 
+/* Base has changed, called with the base locked.  */
 void host1x_update_threshold_waiters_base(uint32_t syncpt_base_id)
 {
     struct host1x_syncpt_base *syncpt_base = &syncpt_bases[syncpt_base_id];
-    struct host1x_syncpt_waiter *waiter, *waiter_next;
-    int i;
+    struct host1x_syncpt_waiter *waiter;
 
-    for (i = 0; i < NV_HOST1X_SYNCPT_NB_PTS; i++) {
-        struct host1x_syncpt *syncpt = &syncpts[i];
-
-        syncpt_lock(syncpt);
+    QLIST_FOREACH(waiter, &syncpt_base->waiters, base_next) {
+        struct host1x_syncpt *syncpt = qatomic_read(&waiter->syncpt);
 
-        QLIST_FOREACH_SAFE(waiter, &syncpt->waiters_base, next, waiter_next) {
-            uint32_t threshold;
+        /* Woken up already, the waiter leaves the base list by itself.  */
+        if (!syncpt)
+            continue;
 
-            if (waiter->base_id != syncpt_base_id)
-                continue;
-
-            syncpt_lock(syncpt_base);
-
-            threshold = syncpt_base->base + waiter->threshold;
+        syncpt_lock(syncpt);
 
-            if (counter_reached_threshold(syncpt->counter, threshold))
-                host1x_unlock_syncpt_waiter(waiter);
+        if (waiter->syncpt == syncpt) {
+            QLIST_REMOVE(waiter, next);
 
-            syncpt_unlock(syncpt_base);
+            if (!host1x_queue_threshold_waiter(syncpt, waiter, true))
+                host1x_wake_syncpt_waiter(syncpt, waiter);
         }
 
         syncpt_unlock(syncpt);
     }
 }
 
+/*
+ * Lock order is base -> syncpt, a waiter woken up by the counter can't take
+ * the base lock, so the waiter removes itself from the base list.
+ */
 void host1x_wait_syncpt_base(struct host1x_syncpt_waiter *waiter,
                              uint32_t syncpt_id, uint32_t syncpt_base_id,
                              uint32_t offset)
 {
     struct host1x_syncpt_base *syncpt_base = &syncpt_bases[syncpt_base_id];
     struct host1x_syncpt *syncpt = &syncpts[syncpt_id];
-    uint32_t threshold;
 
     assert(syncpt_id < NV_HOST1X_SYNCPT_NB_PTS);
     assert(syncpt_base_id < NV_HOST1X_SYNCPT_NB_BASES);
 
+    syncpt_lock(syncpt_base);
     syncpt_lock(syncpt);
 
     waiter->threshold = offset;
     waiter->base_id = syncpt_base_id;
+    waiter->base = true;
+    waiter->co = qemu_in_coroutine() ? qemu_coroutine_self() : NULL;
 
-    threshold = syncpt_base->base + waiter->threshold;
-
-    if (!counter_reached_threshold(syncpt->counter, threshold)) {
-        QLIST_INSERT_HEAD(&syncpt->waiters_base, waiter, next);
-        qemu_event_reset(&waiter->syncpt_ev);
+    if (!host1x_queue_threshold_waiter(syncpt, waiter, false)) {
+        syncpt_unlock(syncpt);
+        syncpt_unlock(syncpt_base);
+        return;
     }
 
-    syncpt_unlock(syncpt);
+    QLIST_INSERT_HEAD(&syncpt_base->waiters, waiter, base_next);
+    syncpt_unlock(syncpt_base);
 
-    qemu_mutex_unlock_iothread();
-    qemu_event_wait(&waiter->syncpt_ev);
-    qemu_mutex_lock_iothread();
+    host1x_sleep_syncpt_waiter(syncpt, waiter);
+
+    syncpt_lock(syncpt_base);
+    QLIST_REMOVE(waiter, base_next);
+    syncpt_unlock(syncpt_base);
 }
@@ -20,6 +20,7 @@
 #include "tegra_common.h"
 
 #include "qapi/error.h"
+#include "qapi/qapi-commands-tegra-target.h"
 #include "qemu/error-report.h"
 #include "hw/sysbus.h"
 
@@ -27,6 +28,7 @@
 #include "iomap.h"
 
 #include "host1x_channel.h"
+#include "host1x_cmd_processor.h"
 #include "host1x_hwlock.h"
 #include "host1x_module.h"
 #include "host1x_priv.h"
@@ -87,6 +89,64 @@ static void tegra_grhost_priv_reset(DeviceState *dev)
     host1x_reset_hwlocks();
     host1x_reset_syncpt_irqs();
     host1x_reset_modules_irqs();
+    host1x_cdma_set_priority(CHANNEL_PRIORITY_RESET);
+}
+
+static TegraCdmaStats *tegra_grhost_cdma_stats(struct host1x_cdma *cdma)
+{
+    struct host1x_cdma_stats *st = &cdma->stats;
+    TegraCdmaStats *info = g_new0(TegraCdmaStats, 1);
+    TegraCdmaOpcodeStats *op = g_new0(TegraCdmaOpcodeStats, 1);
+
+    op->setcl = stat64_get(&st->opcodes[SETCL]);
+    op->incr = stat64_get(&st->opcodes[INCR]);
+    op->nonincr = stat64_get(&st->opcodes[NONINCR]);
+    op->mask = stat64_get(&st->opcodes[MASK]);
+    op->imm = stat64_get(&st->opcodes[IMM]);
+    op->restart = stat64_get(&st->opcodes[RESTART]);
+    op->gather = stat64_get(&st->opcodes[GATHER]);
+    op->extend = stat64_get(&st->opcodes[EXTEND]);
+    op->chdone = stat64_get(&st->opcodes[CHDONE]);
+
+    info->channel = cdma->ch_id;
+    info->enabled = cdma->enabled;
+    info->words = stat64_get(&st->words);
+    info->gathers = stat64_get(&st->gathers);
+    info->opcodes = op;
+    info->syncpt_wait_ns = stat64_get(&st->syncpt_wait_ns);
+    info->mlock_wait_ns = stat64_get(&st->mlock_wait_ns);
+    info->bql_hold_ns = stat64_get(&st->bql_hold_ns);
+    info->high_priority = !!(host1x_cdma_get_priority() & (1 << cdma->ch_id));
+    info->queue_depth = host1x_cdma_queue_depth(cdma);
+    info->slices = stat64_get(&st->slices);
+
+    return info;
+}
+
+TegraCdmaStatsList *qmp_query_tegra_cdma(bool has_reset, bool reset,
+                                         Error **errp)
+{
+    TegraCdmaStatsList *list = NULL;
+    tegra_grhost *s;
+    int i;
+
+    if (!tegra_grhost_dev) {
+        error_setg(errp, "host1x is not available on this machine");
+        return NULL;
+    }
+
+    s = TEGRA_GRHOST(tegra_grhost_dev);
+
+    for (i = CHANNELS_NB - 1; i >= 0; i--) {
+        struct host1x_cdma *cdma = &s->channels[i].cdma;
+
+        QAPI_LIST_PREPEND(list, tegra_grhost_cdma_stats(cdma));
+
+        if (has_reset && reset)
+            host1x_cdma_reset_stats(cdma);
+    }
+
+    return list;
 }
 
 static void tegra_grhost_class_init(ObjectClass *klass, void *data)
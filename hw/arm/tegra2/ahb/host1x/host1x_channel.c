@@ -19,6 +19,7 @@
 
 #include "tegra_common.h"
 
+#include "exec/address-spaces.h"
 
 #include "modules/host1x/host1x.h"
 
@@ -153,6 +154,7 @@ static uint32_t host1x_sync_read_reg(uint32_t addr)
     case INDREG_DMA_CTRL_OFFSET:
         break;
     case CHANNEL_PRIORITY_OFFSET:
+        ret = host1x_cdma_get_priority();
         break;
     case CDMA_ASM_TIMEOUT_OFFSET:
         break;
@@ -337,7 +339,8 @@ static void host1x_sync_write_reg(uint32_t addr, uint32_t value)
         TRACE_WRITE(base, offset, 0, value);
         break;
     case CHANNEL_PRIORITY_OFFSET:
-        TRACE_WRITE(base, offset, 0, value);
+        TRACE_WRITE(base, offset, host1x_cdma_get_priority(), value);
+        host1x_cdma_set_priority(value);
         break;
     case CDMA_ASM_TIMEOUT_OFFSET:
         TRACE_WRITE(base, offset, 0, value);
@@ -563,14 +566,12 @@ static void tegra_host1x_channel_priv_write(void *opaque, hwaddr offset,
         if (s->indoff.acctype == REG) {
             /* Indirect host1x module reg write */
             struct host1x_module *module = get_host1x_module(s->class_id);
-            host1x_cdma_ptr = &s->cdma;
 
             host1x_module_write(module, s->indoffset, value);
         } else {
             /* Indirect memory write */
-            uint32_t *mem = host1x_dma_ptr;
-
-            mem[s->indoffset] = ind_swap(value, s->indoff.indswap);
+            stl_le_phys(&address_space_memory, (hwaddr) s->indoffset << 2,
+                        ind_swap(value, s->indoff.indswap));
         }
 
         if (s->indoff.autoinc) {
@@ -686,8 +687,8 @@ static void tegra_host1x_channel_realize(DeviceState *dev, Error **errp)
     tegra_host1x_channel *s = TEGRA_HOST1X_CHANNEL(dev);
     SysBusDevice *sbd = SYS_BUS_DEVICE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_host1x_channel_mem_ops,
-                          s, "tegra.host1x_channel", SZ_16K);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_host1x_channel_mem_ops,
+                       s, "tegra.host1x_channel", SZ_16K);
     sysbus_init_mmio(sbd, &s->iomem);
 
     s->fifo = host1x_fifo_create(32);
@@ -22,13 +22,14 @@
 
 #include "tegra_common.h"
 
+#include "qemu/coroutine.h"
+#include "qemu/queue.h"
+#include "qemu/stats64.h"
 #include "qemu/thread.h"
 #include "sysemu/dma.h"
 
 #include "host1x_syncpts.h"
 
-extern void *host1x_dma_ptr;
-
 /* TODO: get rid of it*/
 extern __thread struct host1x_cdma *host1x_cdma_ptr;
 
@@ -40,13 +41,63 @@ struct host1x_dma_gather {
     bool inlined:1;
 };
 
+/* Updated by the channel thread only, times are in host nanoseconds.  */
+struct host1x_cdma_stats {
+    Stat64 words;
+    Stat64 gathers;
+    Stat64 opcodes[16];
+    Stat64 syncpt_wait_ns;
+    Stat64 mlock_wait_ns;
+    Stat64 bql_hold_ns;
+    Stat64 slices;
+};
+
+#define HOST1X_CDMA_PAGE_SIZE   4096
+#define HOST1X_CDMA_PAGES_NB    4
+
+/* Push buffer page mapped for the duration of a channel run.  */
+struct host1x_cdma_page {
+    hwaddr addr;
+    uint8_t *ptr;
+};
+
+/* Register write of a decoded gather.  */
+struct host1x_gather_op {
+    struct host1x_module *module;
+    uint32_t data;
+    uint16_t offset;
+    bool first;     /* First write of an opcode */
+};
+
+struct host1x_gather_decode {
+    hwaddr addr;
+    uint32_t count;
+    uint32_t hash;
+    uint32_t gen;
+    ram_addr_t ram_addr;
+    struct host1x_module *start_module;
+    struct host1x_module *end_module;
+    struct host1x_gather_op *ops;
+    unsigned int nr_ops;
+    uint32_t words;
+    uint32_t opcodes[16];
+    QTAILQ_ENTRY(host1x_gather_decode) lru;
+};
+
 struct host1x_cdma {
+    struct host1x_cdma_stats stats;
+    int64_t bql_locked_at;
     struct host1x_syncpt_waiter waiter;
     struct host1x_dma_gather gather;
     struct host1x_module *module;
-    QemuEvent start_ev;
+    struct host1x_cdma_page pages[HOST1X_CDMA_PAGES_NB];
+    GHashTable *gather_cache;
+    QTAILQ_HEAD(, host1x_gather_decode) gather_lru;  /* Head is the oldest */
+    unsigned int next_page;
+    int slice;      /* Opcodes left until the channel yields */
     QemuEvent stop_ev;
-    QemuThread thread;
+    bool running;   /* Channel coroutine exists */
+    bool kick;      /* Command buffer has to be (re)processed */
     uint8_t ch_id;
     uint32_t base:30;
     uint32_t end:30;
@@ -60,5 +111,19 @@ void host1x_cdma_set_end(struct host1x_cdma *cdma, uint32_t end);
 void host1x_cdma_control(struct host1x_cdma *cdma,
                          bool dma_stop, bool dma_get_rst, bool dma_init_get);
 void host1x_init_cdma(struct host1x_cdma *cdma, uint8_t ch_id);
+int64_t host1x_cdma_syncpt_wait(struct host1x_cdma *cdma);
+void host1x_cdma_syncpt_waited(struct host1x_cdma *cdma, int64_t start);
+void host1x_cdma_reset_stats(struct host1x_cdma *cdma);
+void coroutine_fn host1x_cdma_yield(void);
+void coroutine_fn host1x_cdma_sched(struct host1x_cdma *cdma);
+bool host1x_cdma_busy(void);
+uint32_t host1x_cdma_get_priority(void);
+void host1x_cdma_set_priority(uint32_t value);
+uint32_t host1x_cdma_queue_depth(struct host1x_cdma *cdma);
+bool host1x_cdma_read(struct host1x_cdma *cdma, hwaddr addr, uint32_t *data);
+void host1x_gather_cache_init(struct host1x_cdma *cdma);
+struct host1x_gather_decode *
+host1x_gather_cache_lookup(struct host1x_cdma *cdma, hwaddr addr,
+                           uint32_t count);
 
 #endif // TEGRA_HOST1X_CDMA_H
@@ -109,6 +109,6 @@ typedef union restart_op {
     uint32_t reg32;
 } restart_op;
 
-void process_cmd_buf(struct host1x_dma_gather *gather);
+void coroutine_fn process_cmd_buf(struct host1x_dma_gather *gather);
 
 #endif // TEGRA_HOST1X_CMD_PROCESSOR_H
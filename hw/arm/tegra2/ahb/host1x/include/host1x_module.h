@@ -22,6 +22,7 @@
 
 #include "tegra_common.h"
 
+#include "qemu/coroutine.h"
 #include "qemu/queue.h"
 #include "qemu/thread.h"
 
@@ -44,9 +45,11 @@ struct host1x_cdma;
 uint32_t host1x_cpu_get_mlock_val(uint32_t id);
 uint32_t host1x_cpu_acquire_mlock(uint32_t id);
 void host1x_cpu_release_mlock(uint32_t id);
-void host1x_ch_acquire_mlock(struct host1x_cdma *cdma, uint32_t id);
-void host1x_ch_release_mlock(struct host1x_cdma *cdma, uint32_t id);
-void host1x_wake_mlocked_channels(void);
+void coroutine_fn host1x_ch_acquire_mlock(struct host1x_cdma *cdma,
+                                          uint32_t id);
+void coroutine_fn host1x_ch_release_mlock(struct host1x_cdma *cdma,
+                                          uint32_t id);
+void host1x_wake_mlocked_channel(struct host1x_cdma *cdma);
 void host1x_reset_mlocks(void);
 void host1x_init_mlocks(void);
 void register_host1x_bus_module(struct host1x_module* module, void *opaque);
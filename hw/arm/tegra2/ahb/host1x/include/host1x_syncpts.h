@@ -24,6 +24,7 @@
 
 #include "tegra_common.h"
 
+#include "qemu/coroutine.h"
 #include "qemu/queue.h"
 #include "qemu/thread.h"
 #include "hw/irq.h"
@@ -33,8 +34,12 @@
 struct host1x_syncpt_waiter {
     unsigned int threshold:NV_HOST1X_SYNCPT_THESH_WIDTH;
     QLIST_ENTRY(host1x_syncpt_waiter) next;
-    QemuEvent syncpt_ev;
+    QLIST_ENTRY(host1x_syncpt_waiter) base_next;
+    struct host1x_syncpt *syncpt;   /* Syncpoint queued on, NULL if none */
+    Coroutine *co;                  /* Channel coroutine, NULL for vCPUs */
+    uint32_t wake_at;   /* Counter value at which the waiter is satisfied */
     uint8_t base_id;
+    bool base;
 };
 
 void host1x_unlock_syncpt_waiter(struct host1x_syncpt_waiter *waiter);
@@ -396,8 +396,8 @@ static void tegra_dc_priv_realize(DeviceState *dev, Error **errp)
 
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_dc_mem_ops, s,
-                          "tegra.dc", TEGRA_DISPLAY_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_dc_mem_ops, s,
+                       "tegra.dc", TEGRA_DISPLAY_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     init_window(&s->win_a, WIN_A_CAPS);
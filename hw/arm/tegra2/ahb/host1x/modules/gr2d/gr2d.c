@@ -248,8 +248,8 @@ static void tegra_gr2d_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_gr2d *s = TEGRA_GR2D(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_gr2d_mem_ops, s,
-                          "tegra.gr2d", SZ_256K);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_gr2d_mem_ops, s,
+                       "tegra.gr2d", SZ_256K);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     s->gr2d_module[0].class_id = 0x50,
@@ -0,0 +1,107 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tegra_common.h"
+
+#include "hw/sysbus.h"
+
+#include "gr3d.h"
+
+#include "host1x_module.h"
+
+#include "iomap.h"
+#include "tegra_trace.h"
+
+#define TYPE_TEGRA_GR3D "tegra.gr3d"
+#define TEGRA_GR3D(obj) OBJECT_CHECK(tegra_gr3d, (obj), TYPE_TEGRA_GR3D)
+
+static const VMStateDescription vmstate_tegra_gr3d = {
+    .name = "tegra.gr3d",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(regs, tegra_gr3d, GR3D_REGS_NB),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static uint64_t tegra_gr3d_priv_read(void *opaque, hwaddr offset, unsigned size)
+{
+    tegra_gr3d *s = opaque;
+
+    return host1x_module_read(&s->gr3d_module, offset >> 2);
+}
+
+static void tegra_gr3d_priv_write(void *opaque, hwaddr offset,
+                                  uint64_t value, unsigned size)
+{
+    tegra_gr3d *s = opaque;
+
+    host1x_module_write(&s->gr3d_module, offset >> 2, value);
+}
+
+static void tegra_gr3d_priv_reset(DeviceState *dev)
+{
+    tegra_gr3d *s = TEGRA_GR3D(dev);
+
+    memset(s->regs, 0, sizeof(s->regs));
+}
+
+static const MemoryRegionOps tegra_gr3d_mem_ops = {
+    .read = tegra_gr3d_priv_read,
+    .write = tegra_gr3d_priv_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static void tegra_gr3d_priv_realize(DeviceState *dev, Error **errp)
+{
+    tegra_gr3d *s = TEGRA_GR3D(dev);
+
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_gr3d_mem_ops, s,
+                       "tegra.gr3d", TEGRA_GR3D_SIZE);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
+
+    s->gr3d_module.class_id = 0x60;
+    s->gr3d_module.reg_write = gr3d_write;
+    s->gr3d_module.reg_read = gr3d_read;
+    register_host1x_bus_module(&s->gr3d_module, s->regs);
+}
+
+static void tegra_gr3d_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = tegra_gr3d_priv_realize;
+    dc->vmsd = &vmstate_tegra_gr3d;
+    dc->reset = tegra_gr3d_priv_reset;
+}
+
+static const TypeInfo tegra_gr3d_info = {
+    .name = TYPE_TEGRA_GR3D,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(tegra_gr3d),
+    .class_init = tegra_gr3d_class_init,
+};
+
+static void tegra_gr3d_register_types(void)
+{
+    type_register_static(&tegra_gr3d_info);
+}
+
+type_init(tegra_gr3d_register_types)
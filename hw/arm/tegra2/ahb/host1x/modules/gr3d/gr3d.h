@@ -0,0 +1,44 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEGRA_GR3D_H
+#define TEGRA_GR3D_H
+
+#include "hw/sysbus.h"
+
+#include "host1x_module.h"
+
+#define GR3D_INCR_SYNCPT_OFFSET         0x0
+#define GR3D_INCR_SYNCPT_CNTRL_OFFSET   0x1
+#define GR3D_INCR_SYNCPT_ERROR_OFFSET   0x2
+
+#define GR3D_REGS_NB    0x1000
+
+typedef struct tegra_gr3d_state {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    uint32_t regs[GR3D_REGS_NB];
+    struct host1x_module gr3d_module;
+} tegra_gr3d;
+
+void gr3d_write(struct host1x_module *module, uint32_t offset, uint32_t data);
+uint32_t gr3d_read(struct host1x_module *module, uint32_t offset);
+
+#endif // TEGRA_GR3D_H
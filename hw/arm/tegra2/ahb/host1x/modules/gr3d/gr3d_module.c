@@ -21,41 +21,62 @@
 
 #include "hw/sysbus.h"
 
+#include "gr3d.h"
 #include "host1x_module.h"
 #include "host1x_syncpts.h"
 
 #include "tegra_trace.h"
 
-static void gr3d_write(struct host1x_module *module,
-                         uint32_t offset, uint32_t data)
+/*
+ * GR3D register model.  The register file is kept so that the guest reads
+ * back what it programmed, but drawing isn't emulated: rasterisation needs
+ * the vertex and fragment programs to be executed and the GR3D shader ISA
+ * isn't emulated.  Draws are therefore only syncpoint-completed.
+ *
+ * Syncpoint increments never fail, so INCR_SYNCPT_ERROR reads as zero.
+ */
+
+void gr3d_write(struct host1x_module *module, uint32_t offset, uint32_t data)
 {
-    TRACE_WRITE(module->class_id, offset, data, data);
+    uint32_t *regs = module->opaque;
+
+    TRACE_WRITE(module->class_id, offset, regs[offset % GR3D_REGS_NB], data);
 
     switch (offset) {
-    case 0:
+    case GR3D_INCR_SYNCPT_OFFSET:
         host1x_incr_syncpt(data & 0xff);
         break;
+    case GR3D_INCR_SYNCPT_ERROR_OFFSET:
+        break;
+    case GR3D_INCR_SYNCPT_CNTRL_OFFSET:
+    case GR3D_INCR_SYNCPT_ERROR_OFFSET + 1 ... GR3D_REGS_NB - 1:
+        regs[offset] = data;
+        break;
     default:
-//         g_assert_not_reached();
+        TPRINT("%s: bad offset=0x%x data=0x%08x\n", __func__, offset, data);
         break;
     }
 }
 
-static uint32_t gr3d_read(struct host1x_module *module, uint32_t offset)
+uint32_t gr3d_read(struct host1x_module *module, uint32_t offset)
 {
-    TRACE_READ(module->class_id, offset, 0);
-    return 0;
-}
+    uint32_t *regs = module->opaque;
+    uint32_t ret = 0;
 
-static struct host1x_module gr3d_module = {
-    .class_id = 0x60,
-    .reg_write = gr3d_write,
-    .reg_read = gr3d_read,
-};
+    switch (offset) {
+    case GR3D_INCR_SYNCPT_OFFSET:
+    case GR3D_INCR_SYNCPT_ERROR_OFFSET:
+        break;
+    case GR3D_INCR_SYNCPT_CNTRL_OFFSET:
+    case GR3D_INCR_SYNCPT_ERROR_OFFSET + 1 ... GR3D_REGS_NB - 1:
+        ret = regs[offset];
+        break;
+    default:
+        TPRINT("%s: bad offset=0x%x\n", __func__, offset);
+        break;
+    }
 
-static void register_gr3d_module(void)
-{
-    register_host1x_bus_module(&gr3d_module, NULL);
-}
+    TRACE_READ(module->class_id, offset, ret);
 
-type_init(register_gr3d_module);
+    return ret;
+}
@@ -77,8 +77,8 @@ static void tegra_host1x_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_host1x *s = TEGRA_HOST1X(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_host1x_mem_ops, s,
-                          "tegra.host1x", TEGRA_HOST1X_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_host1x_mem_ops, s,
+                       "tegra.host1x", TEGRA_HOST1X_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     s->host1x_module.class_id = 0x1,
@@ -19,6 +19,7 @@
 
 #include "tegra_common.h"
 
+#include "exec/address-spaces.h"
 
 #include "host1x_cdma.h"
 #include "host1x_channel.h"
@@ -28,10 +29,22 @@
 
 #include "tegra_trace.h"
 
+/*
+ * Called by a channel or, for indirect writes, by a vCPU.  A vCPU has no
+ * channel, it waits for syncpoints with a waiter of its own.
+ */
 void host1x_write(struct host1x_module *module, uint32_t offset, uint32_t data)
 {
-    struct host1x_syncpt_waiter *waiter = &host1x_cdma_ptr->waiter;
+    struct host1x_cdma *cdma = host1x_cdma_ptr;
+    struct host1x_syncpt_waiter vcpu_waiter;
+    struct host1x_syncpt_waiter *waiter = &vcpu_waiter;
     struct host1x_regs *regs = module->opaque;
+    int64_t start;
+
+    if (cdma)
+        waiter = &cdma->waiter;
+    else
+        host1x_init_syncpt_waiter(waiter);
 
     TRACE_WRITE(module->class_id, offset, data, data);
 
@@ -57,22 +70,28 @@ void host1x_write(struct host1x_module *module, uint32_t offset, uint32_t data)
     {
         nv_class_host_wait_syncpt method = { .reg32 = data };
 
+        start = host1x_cdma_syncpt_wait(cdma);
         host1x_wait_syncpt(waiter, method.indx, method.thresh);
+        host1x_cdma_syncpt_waited(cdma, start);
         break;
     }
     case NV_CLASS_HOST_WAIT_SYNCPT_BASE_OFFSET:
     {
         nv_class_host_wait_syncpt_base method = { .reg32 = data };
 
+        start = host1x_cdma_syncpt_wait(cdma);
         host1x_wait_syncpt_base(waiter, method.indx, method.base_indx,
                                 method.offset);
+        host1x_cdma_syncpt_waited(cdma, start);
         break;
     }
     case NV_CLASS_HOST_WAIT_SYNCPT_INCR_OFFSET:
     {
         nv_class_host_wait_syncpt_incr method = { .reg32 = data };
 
+        start = host1x_cdma_syncpt_wait(cdma);
         host1x_wait_syncpt_incr(waiter, method.indx);
+        host1x_cdma_syncpt_waited(cdma, start);
         break;
     }
     case NV_CLASS_HOST_LOAD_SYNCPT_BASE_OFFSET:
@@ -142,7 +161,7 @@ void host1x_write(struct host1x_module *module, uint32_t offset, uint32_t data)
     case NV_CLASS_HOST_INDDATA_OFFSET_BEGIN ... NV_CLASS_HOST_INDDATA_OFFSET_END:
     {
         struct host1x_module *ind_module = get_host1x_module(regs->class_id);
-        uint32_t *mem = host1x_dma_ptr;
+        hwaddr mem_addr = (hwaddr) regs->indoffset << 2;
 
         if (regs->indctrl.rwn == WRITE) {
             if (regs->indctrl.acctype == REG) {
@@ -168,8 +187,9 @@ void host1x_write(struct host1x_module *module, uint32_t offset, uint32_t data)
                 if (regs->indctrl.indbe4)
                     wrmask |= 0xff000000;
 
-                mem[regs->indoffset] &= ~wrmask;
-                mem[regs->indoffset] |= (data & wrmask);
+                stl_le_phys(&address_space_memory, mem_addr,
+                            (ldl_le_phys(&address_space_memory, mem_addr) &
+                                ~wrmask) | (data & wrmask));
             }
         } else {
             tegra_host1x_channel *channel =
@@ -181,7 +201,7 @@ void host1x_write(struct host1x_module *module, uint32_t offset, uint32_t data)
                 ret = host1x_module_read(ind_module, regs->indoffset);
             } else {
                 /* Indirect memory read */
-                ret = mem[regs->indoffset];
+                ret = ldl_le_phys(&address_space_memory, mem_addr);
             }
 
             host1x_fifo_push(channel->fifo, ret);
@@ -119,8 +119,8 @@ static void tegra_usb_priv_init(Object *obj)
     tegra_usb *s = TEGRA_USB(obj);
     EHCIState *ehci = &i->ehci;
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_usb_mem_ops, s,
-                          "tegra.usb_susp_ctrl", 4);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_usb_mem_ops, s,
+                       "tegra.usb_susp_ctrl", 4);
     memory_region_add_subregion(&ehci->mem, 0x400, &s->iomem);
 }
 
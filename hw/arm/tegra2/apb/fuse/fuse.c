@@ -819,8 +819,8 @@ static void tegra_fuse_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_fuse *s = TEGRA_FUSE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_fuse_mem_ops, s,
-                          "tegra.fuse", TEGRA_FUSE_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_fuse_mem_ops, s,
+                       "tegra.fuse", TEGRA_FUSE_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
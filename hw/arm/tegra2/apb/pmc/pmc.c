@@ -980,8 +980,8 @@ static void tegra_pmc_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_pmc *s = TEGRA_PMC(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_pmc_mem_ops, s,
-                          "tegra.pmc", TEGRA_PMC_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_pmc_mem_ops, s,
+                       "tegra.pmc", TEGRA_PMC_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
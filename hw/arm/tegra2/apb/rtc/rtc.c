@@ -378,8 +378,8 @@ static void tegra_rtc_priv_realize(DeviceState *dev, Error **errp)
 
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_rtc_mem_ops, s,
-                          "tegra.rtc", TEGRA_RTC_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_rtc_mem_ops, s,
+                       "tegra.rtc", TEGRA_RTC_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     s->p_rtc_sec = ptimer_init(tegra_rtc_tick, s, PTIMER_POLICY);
@@ -184,8 +184,8 @@ static void tegra_uart_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_uart *s = TEGRA_UART(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_uart_mem_ops, s,
-                          "tegra.uart", 64);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_uart_mem_ops, s,
+                       "tegra.uart", 64);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -1496,8 +1496,8 @@ static void tegra_emc_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_emc *s = TEGRA_EMC(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_emc_mem_ops, s,
-                          "tegra.emc", TEGRA_EMC_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_emc_mem_ops, s,
+                       "tegra.emc", TEGRA_EMC_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -1230,8 +1230,8 @@ static void tegra_mc_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_mc *s = TEGRA_MC(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_mc_mem_ops, s,
-                          "tegra.mc", TEGRA_MC_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_mc_mem_ops, s,
+                       "tegra.mc", TEGRA_MC_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
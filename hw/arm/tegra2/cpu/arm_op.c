@@ -23,6 +23,11 @@
 #include "cpu.h"
 #include "exec/helper-proto.h"
 #include "exec/exec-all.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-tegra-target.h"
+#include "qemu/main-loop.h"
+#include "qemu/stats64.h"
+#include "target/arm/internals.h"
 
 #include "devices.h"
 #include "iomap.h"
@@ -31,7 +36,23 @@
 
 #define HALT_WFE    0xff
 
+/*
+ * WFE parks the vCPU thread like WFI does, unless the event register is
+ * set.  It is set by SEV of any A9 core, which also kicks the cores parked
+ * in WFE.  IRQs and flow controller wakes end the park as well.  Wakers
+ * record the reason, the woken CPU accounts it on its next WFE.
+ */
+typedef struct tegra_wfe_stats {
+    Stat64 wfe;
+    Stat64 sleeps;
+    Stat64 wakes[TEGRA_WAKE_NR];
+    int wake_reason;
+    bool parked;
+} tegra_wfe_stats;
+
 static int tegra_cpus[TEGRA2_NCPUS];
+static bool tegra_event_reg[TEGRA2_NCPUS];
+static tegra_wfe_stats tegra_wfe_stats_tbl[TEGRA2_NCPUS];
 
 void set_is_tegra_cpu(int cpu_id)
 {
@@ -74,21 +95,135 @@ uint32_t tegra_get_wfe_bitmap(void)
     return wfe_bitmap;
 }
 
+/* Records why a CPU parked in WFE got woken, the first reason wins.  */
+void tegra_cpu_note_wake(int cpu_id, int reason)
+{
+    qatomic_cmpxchg(&tegra_wfe_stats_tbl[cpu_id].wake_reason, -1, reason);
+}
+
+static void tegra_wfe_account_wake(tegra_wfe_stats *st)
+{
+    int reason;
+
+    if (!st->parked)
+        return;
+
+    reason = qatomic_xchg(&st->wake_reason, -1);
+    if (reason < 0)
+        reason = TEGRA_WAKE_IRQ;
+
+    stat64_add(&st->wakes[reason], 1);
+    st->parked = false;
+}
+
 void HELPER(wfe)(CPUARMState *env)
 {
     CPUState *cs = env_cpu(env);
     int cpu_id = cs->cpu_index;
+    tegra_wfe_stats *st;
 
-    if (is_tegra_cpu(cpu_id)) {
-//         TPRINT("WFE: cpu %d\n", cpu_id);
+    if (!is_tegra_cpu(cpu_id)) {
+        HELPER(yield)(env);
+        return;
+    }
+
+    st = &tegra_wfe_stats_tbl[cpu_id];
+
+    tegra_wfe_account_wake(st);
+    stat64_add(&st->wfe, 1);
+
+    if (qatomic_xchg(&tegra_event_reg[cpu_id], false))
+        return;
+
+    qatomic_set(&st->wake_reason, -1);
+    cs->halted = HALT_WFE;
+
+    tegra_flow_wfe_handle(cpu_id);
 
-        cs->halted = HALT_WFE;
+    /* Won't return here if flow powergated CPU.  */
 
-        tegra_flow_wfe_handle(cpu_id);
+    /* Pairs with the barrier in HELPER(sev).  */
+    smp_mb();
 
-        /* Won't return here if flow powergated CPU.  */
+    if (cpu_has_work(cs) || qatomic_xchg(&tegra_event_reg[cpu_id], false)) {
         cs->halted = 0;
+        return;
+    }
+
+    st->parked = true;
+    stat64_add(&st->sleeps, 1);
+    tegra_idle_warp_kick();
+
+    cs->exception_index = EXCP_HLT;
+    cpu_loop_exit(cs);
+}
+
+void arm_cpu_wfi_sleep(CPUState *cs)
+{
+    if (is_tegra_cpu(cs->cpu_index))
+        tegra_idle_warp_kick();
+}
+
+void HELPER(sev)(CPUARMState *env)
+{
+    CPUState *cs = env_cpu(env);
+    int i;
+
+    if (!is_tegra_cpu(cs->cpu_index))
+        return;
+
+    for (i = 0; i < TEGRA2_A9_NCORES; i++)
+        qatomic_set(&tegra_event_reg[i], true);
+
+    smp_mb();
+
+    for (i = 0; i < TEGRA2_A9_NCORES; i++) {
+        CPUState *sibling = qemu_get_cpu(i);
+
+        if (sibling == cs || qatomic_read(&sibling->halted) != HALT_WFE)
+            continue;
+
+        tegra_cpu_note_wake(i, TEGRA_WAKE_SEV);
+
+        qemu_mutex_lock_iothread();
+        cpu_interrupt(sibling, CPU_INTERRUPT_EXITTB);
+        qemu_mutex_unlock_iothread();
+    }
+}
+
+TegraCpuIdleStatsList *qmp_query_tegra_cpu_idle(bool has_reset, bool reset,
+                                                Error **errp)
+{
+    TegraCpuIdleStatsList *list = NULL;
+    int i, r;
+
+    if (!is_tegra_cpu(TEGRA2_A9_CORE0)) {
+        error_setg(errp, "Tegra CPUs are not available on this machine");
+        return NULL;
+    }
+
+    for (i = TEGRA2_A9_NCORES - 1; i >= 0; i--) {
+        tegra_wfe_stats *st = &tegra_wfe_stats_tbl[i];
+        TegraCpuIdleStats *info = g_new0(TegraCpuIdleStats, 1);
+
+        info->cpu = i;
+        info->parked = st->parked;
+        info->wfe = stat64_get(&st->wfe);
+        info->sleeps = stat64_get(&st->sleeps);
+        info->wake_irq = stat64_get(&st->wakes[TEGRA_WAKE_IRQ]);
+        info->wake_sev = stat64_get(&st->wakes[TEGRA_WAKE_SEV]);
+        info->wake_flow = stat64_get(&st->wakes[TEGRA_WAKE_FLOW]);
+
+        QAPI_LIST_PREPEND(list, info);
+
+        if (has_reset && reset) {
+            stat64_init(&st->wfe, 0);
+            stat64_init(&st->sleeps, 0);
+
+            for (r = 0; r < TEGRA_WAKE_NR; r++)
+                stat64_init(&st->wakes[r], 0);
+        }
     }
 
-    HELPER(yield)(env);
+    return list;
 }
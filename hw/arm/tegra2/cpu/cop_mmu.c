@@ -24,9 +24,6 @@
 #include "cpu.h"
 #include "exec/exec-all.h"
 
-#include "tcg/tcg-op.h"
-#include "sysemu/tcg.h"
-
 #include "devices.h"
 #include "sizes.h"
 #include "tegra_cpu.h"
@@ -35,8 +32,19 @@
 #define TYPE_TEGRA_COP_MMU "tegra.cop_mmu"
 #define TEGRA_COP_MMU(obj) OBJECT_CHECK(tegra_cop_mmu, (obj), TYPE_TEGRA_COP_MMU)
 
+/*
+ * AVP MMU, a small set of PTEs that translate 64K aligned windows of the
+ * COP physical address space.  A PTE translates only the accesses its
+ * permission bits allow, others fall through to the next PTE and finally
+ * hit the memory untranslated.  Since TLB entries are per virtual page, a
+ * PTE update invalidates just the old and the new window of that PTE.
+ */
+
+#define PTE_NB          4
+
 #define PTE0_COMPARE    0xF000
 #define PTE0_TRANSLATE  0xF004
+#define PTE_STRIDE      8
 
 #define TRANSLATE_DATA  (1 << 11)
 #define TRANSLATE_CODE  (1 << 10)
@@ -45,26 +53,43 @@
 #define TRANSLATE_HIT   (1 << 7)
 #define TRANSLATE_EN    (1 << 2)
 
+#define COP_MMUIDX_ALL  ((1 << NB_MMU_MODES) - 1)
+
+typedef struct tegra_cop_mmu_pte {
+    uint16_t virt_base;
+    uint16_t phys_base;
+    uint16_t flags;
+    uint16_t mask;
+} tegra_cop_mmu_pte;
+
 typedef struct tegra_cop_mmu_state {
     SysBusDevice parent_obj;
 
     MemoryRegion iomem;
 
-    uint16_t translate_virt_base;
-    uint16_t translate_phys_base;
-    uint16_t translate_flags;
-    uint16_t translate_mask;
+    tegra_cop_mmu_pte pte[PTE_NB];
 } tegra_cop_mmu;
 
-static const VMStateDescription vmstate_tegra_cop_mmu = {
-    .name = "tegra.cop_mmu",
+static const VMStateDescription vmstate_tegra_cop_mmu_pte = {
+    .name = "tegra.cop_mmu/pte",
     .version_id = 1,
     .minimum_version_id = 1,
     .fields = (VMStateField[]) {
-        VMSTATE_UINT16(translate_virt_base, tegra_cop_mmu),
-        VMSTATE_UINT16(translate_phys_base, tegra_cop_mmu),
-        VMSTATE_UINT16(translate_flags, tegra_cop_mmu),
-        VMSTATE_UINT16(translate_mask, tegra_cop_mmu),
+        VMSTATE_UINT16(virt_base, tegra_cop_mmu_pte),
+        VMSTATE_UINT16(phys_base, tegra_cop_mmu_pte),
+        VMSTATE_UINT16(flags, tegra_cop_mmu_pte),
+        VMSTATE_UINT16(mask, tegra_cop_mmu_pte),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_tegra_cop_mmu = {
+    .name = "tegra.cop_mmu",
+    .version_id = 2,
+    .minimum_version_id = 2,
+    .fields = (VMStateField[]) {
+        VMSTATE_STRUCT_ARRAY(pte, tegra_cop_mmu, PTE_NB, 1,
+                             vmstate_tegra_cop_mmu_pte, tegra_cop_mmu_pte),
         VMSTATE_END_OF_LIST()
     }
 };
@@ -73,32 +98,65 @@ static uint64_t tegra_cop_mmu_priv_read(void *opaque, hwaddr offset,
                                         unsigned size)
 {
     tegra_cop_mmu *s = opaque;
+    tegra_cop_mmu_pte *pte;
     uint64_t ret = 0;
 
     if (current_cpu != qemu_get_cpu(TEGRA2_COP)) {
         return ret;
     }
 
-    switch (offset) {
-    case PTE0_COMPARE:
-        ret = (s->translate_virt_base << 16) | s->translate_mask;
+    if (offset < PTE0_COMPARE || offset >= PTE0_COMPARE + PTE_NB * PTE_STRIDE)
+        goto out;
+
+    pte = &s->pte[(offset - PTE0_COMPARE) / PTE_STRIDE];
+
+    switch (offset & (PTE_STRIDE - 1)) {
+    case PTE0_COMPARE & (PTE_STRIDE - 1):
+        ret = (pte->virt_base << 16) | pte->mask;
         break;
-    case PTE0_TRANSLATE:
-        ret = (s->translate_phys_base << 16) | s->translate_flags;
+    case PTE0_TRANSLATE & (PTE_STRIDE - 1):
+        ret = (pte->phys_base << 16) | pte->flags;
         break;
     default:
         break;
     }
 
+out:
     TRACE_READ(s->iomem.addr, offset, ret);
 
     return ret;
 }
 
+/*
+ * Invalidates the virtual window of the PTE.  The window is a single range
+ * per 1G quadrant when the mask is contiguous from the top, otherwise it
+ * is scattered and the whole TLB goes.
+ */
+static void tegra_cop_mmu_flush_pte(CPUState *cs, tegra_cop_mmu_pte *pte)
+{
+    uint32_t mask = pte->mask;
+    uint32_t low = ~mask & 0x3FFF;
+    target_ulong quad;
+
+    if (!(pte->flags & TRANSLATE_EN) || (pte->virt_base & ~mask))
+        return;
+
+    if (low & (low + 1)) {
+        tlb_flush(cs);
+        return;
+    }
+
+    for (quad = 0; quad < 4; quad++)
+        tlb_flush_range_by_mmuidx(cs, (quad << 30) | (pte->virt_base << 16),
+                                  (target_ulong) (low + 1) << 16,
+                                  COP_MMUIDX_ALL, TARGET_LONG_BITS);
+}
+
 static void tegra_cop_mmu_priv_write(void *opaque, hwaddr offset,
                                      uint64_t value, unsigned size)
 {
     tegra_cop_mmu *s = opaque;
+    tegra_cop_mmu_pte *pte;
     uint32_t old __attribute__ ((unused));
 
     /* MMU is in main address space for simplicity. Avoid CPU access.  */
@@ -107,51 +165,43 @@ static void tegra_cop_mmu_priv_write(void *opaque, hwaddr offset,
         return;
     }
 
-    switch (offset) {
-    case PTE0_COMPARE:
-        old = (s->translate_virt_base << 16) | s->translate_mask;
+    if (offset < PTE0_COMPARE || offset >= PTE0_COMPARE + PTE_NB * PTE_STRIDE) {
+        TRACE_WRITE(s->iomem.addr, offset, 0, value);
+        return;
+    }
+
+    pte = &s->pte[(offset - PTE0_COMPARE) / PTE_STRIDE];
+
+    tegra_cop_mmu_flush_pte(current_cpu, pte);
+
+    switch (offset & (PTE_STRIDE - 1)) {
+    case PTE0_COMPARE & (PTE_STRIDE - 1):
+        old = (pte->virt_base << 16) | pte->mask;
         TRACE_WRITE(s->iomem.addr, offset, old, value);
 
-        s->translate_virt_base = value >> 16;
-        s->translate_mask = value & 0x3FFF;
+        pte->virt_base = value >> 16;
+        pte->mask = value & 0x3FFF;
         break;
-    case PTE0_TRANSLATE:
-        old = (s->translate_phys_base << 16) | s->translate_flags;
+    case PTE0_TRANSLATE & (PTE_STRIDE - 1):
+        old = (pte->phys_base << 16) | pte->flags;
         TRACE_WRITE(s->iomem.addr, offset, old, value);
 
-        s->translate_phys_base = (value >> 16) & 0x3FFF;
-        s->translate_flags = value & 0xFFF;
-
-        if (s->translate_flags & TRANSLATE_EN) {
-            /* Too much churn to implement correctly.  */
-            g_assert(s->translate_flags & TRANSLATE_DATA);
-            g_assert(s->translate_flags & TRANSLATE_HIT);
-            g_assert(s->translate_flags & TRANSLATE_RD);
-            g_assert(s->translate_flags & TRANSLATE_WR);
-            g_assert(s->translate_flags & TRANSLATE_CODE);
-        }
+        pte->phys_base = (value >> 16) & 0x3FFF;
+        pte->flags = value & 0xFFF;
         break;
     default:
         TRACE_WRITE(s->iomem.addr, offset, 0, value);
         return;
     }
 
-    tlb_flush(current_cpu);
-
-    if (tcg_enabled()) {
-        tcg_gen_goto_tb(0);
-        tcg_gen_exit_tb(NULL, 0);
-    }
+    tegra_cop_mmu_flush_pte(current_cpu, pte);
 }
 
 static void tegra_cop_mmu_priv_reset(DeviceState *dev)
 {
     tegra_cop_mmu *s = TEGRA_COP_MMU(dev);
 
-    s->translate_virt_base = 0;
-    s->translate_phys_base = 0;
-    s->translate_flags = 0;
-    s->translate_mask = 0;
+    memset(s->pte, 0, sizeof(s->pte));
 }
 
 static const MemoryRegionOps tegra_cop_mmu_mem_ops = {
@@ -160,37 +210,73 @@ static const MemoryRegionOps tegra_cop_mmu_mem_ops = {
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
-static hwaddr tegra_cop_mmu_translate(hwaddr addr, int access_type)
+static bool tegra_cop_mmu_pte_allows(tegra_cop_mmu_pte *pte, int access_type)
 {
-    tegra_cop_mmu *s = tegra_cop_mmu_dev;
-    hwaddr phys_base = s->translate_phys_base & s->translate_mask;
-    hwaddr virt_base = s->translate_virt_base;
-//     hwaddr orig = addr;
-
-    if (!(s->translate_flags & TRANSLATE_EN)) {
-        return addr;
+    switch (access_type) {
+    case MMU_INST_FETCH:
+        return pte->flags & TRANSLATE_CODE;
+    case MMU_DATA_STORE:
+        return (pte->flags & TRANSLATE_DATA) && (pte->flags & TRANSLATE_WR);
+    default:
+        return (pte->flags & TRANSLATE_DATA) && (pte->flags & TRANSLATE_RD);
     }
+}
 
-    if (((addr >> 16) & s->translate_mask) != virt_base) {
-//         printf("NOT! translated 0x%08X\n", (uint32_t) addr);
-        return addr;
-    }
+static hwaddr tegra_cop_mmu_translate_access(tegra_cop_mmu *s, hwaddr addr,
+                                             int access_type)
+{
+    tegra_cop_mmu_pte *pte;
+    int i;
+
+    for (i = 0; i < PTE_NB; i++) {
+        pte = &s->pte[i];
 
-    addr &= ~((0xC000 | s->translate_mask) << 16);
-    addr |= (0x8000 | phys_base) << 16;
+        if (!(pte->flags & TRANSLATE_EN))
+            continue;
 
-//     printf("translate 0x%08X -> 0x%08X\n", (uint32_t) orig, (uint32_t) addr);
+        if (((addr >> 16) & pte->mask) != pte->virt_base)
+            continue;
+
+        if (!tegra_cop_mmu_pte_allows(pte, access_type))
+            continue;
+
+        addr &= ~((0xC000 | pte->mask) << 16);
+        addr |= (0x8000 | (pte->phys_base & pte->mask)) << 16;
+        break;
+    }
 
     return addr;
 }
 
+/*
+ * The TLB entry serves all access types, so *prot is narrowed to the types
+ * that translate the page to the same address.
+ */
+static hwaddr tegra_cop_mmu_translate(hwaddr addr, int access_type,
+                                      int *prot)
+{
+    tegra_cop_mmu *s = tegra_cop_mmu_dev;
+    hwaddr ret = tegra_cop_mmu_translate_access(s, addr, access_type);
+
+    *prot = 0;
+
+    if (tegra_cop_mmu_translate_access(s, addr, MMU_DATA_LOAD) == ret)
+        *prot |= PAGE_READ;
+    if (tegra_cop_mmu_translate_access(s, addr, MMU_DATA_STORE) == ret)
+        *prot |= PAGE_WRITE;
+    if (tegra_cop_mmu_translate_access(s, addr, MMU_INST_FETCH) == ret)
+        *prot |= PAGE_EXEC;
+
+    return ret;
+}
+
 static void tegra_cop_mmu_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_cop_mmu *s = TEGRA_COP_MMU(dev);
     CPUState *cs = qemu_get_cpu(TEGRA2_COP);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_cop_mmu_mem_ops, s,
-                          "tegra.cop_mmu", SZ_64K);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_cop_mmu_mem_ops, s,
+                       "tegra.cop_mmu", SZ_64K);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     ARM_CPU(cs)->translate_addr = tegra_cop_mmu_translate;
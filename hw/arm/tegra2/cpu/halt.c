@@ -77,6 +77,7 @@ void tegra_cpu_run(int cpu_id)
     cpu_resume(cs);
 
     if (cs->halted) {
+        tegra_cpu_note_wake(cpu_id, TEGRA_WAKE_FLOW);
         cpu_interrupt(cs, CPU_INTERRUPT_EXITTB);
     }
 }
@@ -87,6 +88,7 @@ void tegra_cpu_halt(int cpu_id)
 
     tegra_cpu_stop(cpu_id);
     tcpu_halted[cpu_id] = 1;
+    tegra_idle_warp_kick();
 }
 
 int tegra_cpu_halted(int cpu_id)
@@ -0,0 +1,160 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Idle fast-forward, enabled with "-machine tegra2-*,idle-warp=on".  While
+ * every CPU is halted by the flow controller, held in reset or sleeping in
+ * WFI/WFE with nothing to wake it up, only a timer can end the idle period.
+ * Rather than waiting it out in wall-clock time, the VIRTUAL clock is
+ * advanced straight to the nearest deadline, that covers the timers, the
+ * RTC, the MPTimer and the DC vblank ptimer alike.
+ *
+ * Host1x channels with work in flight and queued BSE jobs keep the clock
+ * running, guests wait for them with timeouts.  A channel blocked on a
+ * syncpoint doesn't, only the CPU or another channel can unblock it.
+ *
+ * Warping is tried as soon as a CPU is halted, parked in WFE or sleeps in
+ * WFI.  While only some of the CPUs idle, or the engines are still busy, a
+ * realtime timer polls for the rest of the machine to follow; it isn't
+ * re-armed once every CPU runs again.
+ */
+
+#include "tegra_common.h"
+
+#include "hw/core/cpu.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "sysemu/cpu-timers.h"
+#include "sysemu/runstate.h"
+
+#include "devices.h"
+#include "host1x_cdma.h"
+#include "tegra_cpu.h"
+
+#include "tegra_cpu_priv.h"
+
+#define TEGRA_IDLE_WARP_POLL_NS     SCALE_MS
+
+static QEMUBH *tegra_idle_warp_bh;
+static QEMUTimer *tegra_idle_warp_timer;
+
+/* Number of CPUs that only an interrupt or a flow controller wake can run.  */
+static int tegra_cpus_nr_idle(void)
+{
+    CPUState *cs;
+    int i, nr_idle = 0;
+
+    for (i = 0; i < TEGRA2_NCPUS; i++) {
+        cs = qemu_get_cpu(i);
+
+        if (tegra_cpu_halted(i) || tegra_cpu_reset_asserted(i))
+            nr_idle++;
+        else if (qatomic_read(&cs->halted) && !cpu_has_work(cs))
+            nr_idle++;
+    }
+
+    return nr_idle;
+}
+
+static void tegra_idle_warp_poll_arm(void)
+{
+    timer_mod(tegra_idle_warp_timer,
+              qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + TEGRA_IDLE_WARP_POLL_NS);
+}
+
+/*
+ * Warps the clock if the whole machine idles.  The poll is kept armed
+ * while only a part of it does, and stops once every CPU runs.
+ */
+static bool tegra_idle_warp(void)
+{
+    int64_t deadline;
+    int nr_idle;
+
+    if (!runstate_is_running())
+        return false;
+
+    nr_idle = tegra_cpus_nr_idle();
+    if (nr_idle == 0)
+        return false;
+
+    if (nr_idle < TEGRA2_NCPUS || host1x_cdma_busy() || tegra_bse_busy()) {
+        tegra_idle_warp_poll_arm();
+        return false;
+    }
+
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          QEMU_TIMER_ATTR_ALL);
+    /* Already expired and about to run, check again after it did.  */
+    if (deadline == 0)
+        tegra_idle_warp_poll_arm();
+
+    /* Nothing armed, only an external event can wake the machine.  */
+    if (deadline <= 0)
+        return false;
+
+    cpu_clock_warp(deadline);
+
+    return true;
+}
+
+static void tegra_idle_warp_bh_cb(void *opaque)
+{
+    /*
+     * The expired timer may leave the CPUs idle, e.g. a periodic tick with
+     * its IRQ masked, retry once it has run.
+     */
+    if (tegra_idle_warp())
+        qemu_bh_schedule(tegra_idle_warp_bh);
+}
+
+static void tegra_idle_warp_poll(void *opaque)
+{
+    if (tegra_idle_warp())
+        qemu_bh_schedule(tegra_idle_warp_bh);
+}
+
+static void tegra_idle_warp_vm_state_change(void *opaque, bool running,
+                                            RunState state)
+{
+    /* CPUs may have been left idle when the VM was stopped.  */
+    if (running)
+        qemu_bh_schedule(tegra_idle_warp_bh);
+}
+
+/* Called when a CPU goes idle, from any thread.  */
+void tegra_idle_warp_kick(void)
+{
+    if (tegra_idle_warp_bh)
+        qemu_bh_schedule(tegra_idle_warp_bh);
+}
+
+void tegra_idle_warp_init(void)
+{
+    if (icount_enabled()) {
+        error_report("idle-warp is incompatible with icount");
+        exit(1);
+    }
+
+    tegra_idle_warp_bh = qemu_bh_new(tegra_idle_warp_bh_cb, NULL);
+    tegra_idle_warp_timer = timer_new_ns(QEMU_CLOCK_REALTIME,
+                                         tegra_idle_warp_poll, NULL);
+    qemu_add_vm_change_state_handler(tegra_idle_warp_vm_state_change, NULL);
+}
@@ -75,5 +75,6 @@ extern void *tegra_ahb_dma_dev;
 
 void tegra_a9mpcore_reset(void);
 void tegra_device_reset(void *dev_);
+bool tegra_bse_busy(void);
 
 #endif // TEGRA_DEVICES_H
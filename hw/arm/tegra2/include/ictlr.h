@@ -49,6 +49,10 @@ typedef struct tegra_ictlr_state {
     uint32_t cpu_iep_class[4];
     uint32_t cop_ier[4];
     uint32_t cop_iep_class[4];
+
+    /* Banks with a VIRQ (bits 0-3) or VFIQ (bits 4-7) pending.  */
+    uint8_t cpu_pending_banks;
+    uint8_t cop_pending_banks;
 } tegra_ictlr;
 
 void tegra_flow_on_irq(int cpu_id);
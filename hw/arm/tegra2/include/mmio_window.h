@@ -0,0 +1,62 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEGRA_MMIO_WINDOW_H
+#define TEGRA_MMIO_WINDOW_H
+
+/*
+ * Sparse MMIO decode: a region made of sub-device windows, looked up by
+ * binary search over a table sorted at realize time.
+ */
+typedef struct tegra_mmio_window {
+    hwaddr start;
+    hwaddr size;
+    uint32_t base;      /* Address the window is traced as */
+} tegra_mmio_window;
+
+typedef struct tegra_mmio_windows {
+    tegra_mmio_window *win;
+    unsigned nr;
+} tegra_mmio_windows;
+
+void tegra_mmio_windows_init(tegra_mmio_windows *w,
+                             const tegra_mmio_window *table, unsigned nr);
+
+/* Returns the window containing the offset or NULL.  */
+static inline const tegra_mmio_window *
+tegra_mmio_window_find(const tegra_mmio_windows *w, hwaddr offset)
+{
+    unsigned lo = 0, hi = w->nr;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        const tegra_mmio_window *win = &w->win[mid];
+
+        if (offset < win->start)
+            hi = mid;
+        else if (offset - win->start >= win->size)
+            lo = mid + 1;
+        else
+            return win;
+    }
+
+    return NULL;
+}
+
+#endif // TEGRA_MMIO_WINDOW_H
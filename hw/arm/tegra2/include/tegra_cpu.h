@@ -34,9 +34,20 @@ void tegra_cpu_reset_deassert(int cpu_id, int flow);
 int tegra_cpu_is_powergated(int cpu_id);
 void tegra_cpu_powergate(int cpu_id);
 void tegra_cpu_unpowergate(int cpu_id);
+
+enum {
+    TEGRA_WAKE_IRQ,
+    TEGRA_WAKE_SEV,
+    TEGRA_WAKE_FLOW,
+    TEGRA_WAKE_NR
+};
+
 uint32_t tegra_get_wfe_bitmap(void);
+void tegra_cpu_note_wake(int cpu_id, int reason);
 void tegra_flow_wfe_handle(int cpu_id);
 void tegra_cpu_reset_init(void);
 int tegra_sibling_cpu(int cpu_id);
 int tegra_cpu_halted(int cpu_id);
 void set_is_tegra_cpu(int cpu_id);
+void tegra_idle_warp_init(void);
+void tegra_idle_warp_kick(void);
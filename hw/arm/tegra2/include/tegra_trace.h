@@ -19,6 +19,8 @@
 
 /* WARNING: HACK */
 
+#include "exec/memory.h"
+#include "qemu/atomic.h"
 #include "hw/irq.h"
 struct IRQState {
     Object parent_obj;
@@ -28,7 +30,52 @@ struct IRQState {
     int n;
 };
 
-#ifdef TEGRA_TRACE
+/* Trace event classes, switched at runtime with tegra-trace-set.  */
+#define TEGRA_TRACE_EV_RW       (1 << 0)
+#define TEGRA_TRACE_EV_IRQ      (1 << 1)
+#define TEGRA_TRACE_EV_TXT      (1 << 2)
+#define TEGRA_TRACE_EV_CDMA     (1 << 3)
+#define TEGRA_TRACE_EV_ALL      0xf
+
+/* Size of rw, irq and cdma trace packets, text packets span several */
+#define TEGRA_TRACE_REC_SIZE    36
+
+/* cpu_id of the packets originating from host1x CDMA */
+#define TEGRA_TRACE_CPU_CDMA    0x1010
+
+/* hwaddr of the recorded packets that aren't bound to a device */
+#define TEGRA_TRACE_NO_DEVICE   0xffffffff
+
+#define TEGRA_TRACE_FMT_MAX_ARGS    16
+
+/* Argument types of a TPRINT format.  Integers are traced as 4 bytes,
+ * strings as 4 bytes length followed by the chars and the rest as 8 bytes,
+ * all in big-endian.  */
+enum {
+    TEGRA_TRACE_ARG_INT,
+    TEGRA_TRACE_ARG_LONG,
+    TEGRA_TRACE_ARG_LLONG,
+    TEGRA_TRACE_ARG_PTR,
+    TEGRA_TRACE_ARG_DOUBLE,
+    TEGRA_TRACE_ARG_STR,
+};
+
+/* TPRINT call site, the format gets its ID on first use and only the ID
+ * plus raw arguments are traced afterwards.  */
+typedef struct tegra_trace_fmt {
+    const char *fmt;
+    uint32_t id;
+    uint8_t nargs;
+    uint8_t args[TEGRA_TRACE_FMT_MAX_ARGS];
+} tegra_trace_fmt;
+
+/* Union of the event classes enabled for any device.  */
+extern uint32_t tegra_trace_dstate;
+
+static inline bool tegra_trace_event_enabled(uint32_t ev)
+{
+    return unlikely(qatomic_read(&tegra_trace_dstate) & ev);
+}
 
 typedef union tegra_trace_rw_u {
     struct {
@@ -54,34 +101,21 @@ static inline uint32_t ttrw(int rw, int c, int r, int s)
     return ret.val;
 }
 
-#define TRACE_READ_MEM(a, o, v, s)          tegra_trace_write(a, o, v, 0, ttrw(0,0,0,s))
-#define TRACE_WRITE_MEM(a, o, v, s)         tegra_trace_write(a, o, v, v, ttrw(1,0,0,s))
-#define TRACE_READ(a, o, v)                 tegra_trace_write(a, o, v, 0, ttrw(0,0,0,4))
-#define TRACE_WRITE(a, o, v, n)             tegra_trace_write(a, o, v, n, ttrw(1,0,0,4))
-#define TRACE_READ_EXT(a, o, v, c, r)       tegra_trace_write(a, o, v, 0, ttrw(0,c,r,4))
-#define TRACE_WRITE_EXT(a, o, v, n, c, r)   tegra_trace_write(a, o, v, n, ttrw(1,c,r,4))
-#define TRACE_IRQ_RAISE(a, i)               do {tegra_trace_irq(a, i->n, 1); qemu_irq_raise(i);} while (0)
-#define TRACE_IRQ_LOWER(a, i)               do {tegra_trace_irq(a, i->n, 0); qemu_irq_lower(i);} while (0)
-#define TRACE_IRQ_SET(a, i, v)              do {tegra_trace_irq(a, (i)->n, v); qemu_set_irq(i,v);} while (0)
-#define TPRINT(f, ...)                      tegra_trace_text_message(f, ## __VA_ARGS__)
-#define TRACE_CDMA(d, g, c)                 tegra_trace_cdma(d, g, c)
-#define TRACE_CDMA_START(c)                 tegra_trace_cdma(0xA << 28, 0, c)
-#define TRACE_CDMA_STOP(c)                  tegra_trace_cdma(0xB << 28, 0, c)
-#else
-#define TRACE_READ_MEM(a, o, v, s)          do {(void)(a); (void)(o); (void)(v); (void)(s);} while (0)
-#define TRACE_WRITE_MEM(a, o, v, s)         do {(void)(a); (void)(o); (void)(v); (void)(s);} while (0)
-#define TRACE_READ(a, o, v)                 do {(void)(a); (void)(o); (void)(v);} while (0)
-#define TRACE_WRITE(a, o, v, n)             do {(void)(a); (void)(o); (void)(v); (void)(n);} while (0)
-#define TRACE_READ_EXT(a, o, v, c, r)       do {(void)(a); (void)(o); (void)(v); (void)(c); (void)(r);} while (0)
-#define TRACE_WRITE_EXT(a, o, v, n, c, r)   do {(void)(a); (void)(o); (void)(v); (void)(n); (void)(c); (void)(r);} while (0)
-#define TRACE_IRQ_RAISE(a, i)               do {(void)(a); qemu_irq_raise(i);} while (0)
-#define TRACE_IRQ_LOWER(a, i)               do {(void)(a); qemu_irq_lower(i);} while (0)
-#define TRACE_IRQ_SET(a, i, v)              do {(void)(a); qemu_set_irq(i,v);} while (0)
-#define TPRINT(f, ...)                      do {} while (0)
-#define TRACE_CDMA(d, g, c)                 do {(void)(d); (void)(g); (void)(c);} while (0)
-#define TRACE_CDMA_START(c)                 do {(void)(c);} while (0)
-#define TRACE_CDMA_STOP(c)                  do {(void)(c);} while (0)
-#endif //TEGRA_TRACE
+#define TRACE_EV(ev, call)                  do {if (tegra_trace_event_enabled(ev)) {call;}} while (0)
+
+#define TRACE_READ_MEM(a, o, v, s)          TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, 0, ttrw(0,0,0,s)))
+#define TRACE_WRITE_MEM(a, o, v, s)         TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, v, ttrw(1,0,0,s)))
+#define TRACE_READ(a, o, v)                 TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, 0, ttrw(0,0,0,4)))
+#define TRACE_WRITE(a, o, v, n)             TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, n, ttrw(1,0,0,4)))
+#define TRACE_READ_EXT(a, o, v, c, r)       TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, 0, ttrw(0,c,r,4)))
+#define TRACE_WRITE_EXT(a, o, v, n, c, r)   TRACE_EV(TEGRA_TRACE_EV_RW, tegra_trace_write(a, o, v, n, ttrw(1,c,r,4)))
+#define TRACE_IRQ_RAISE(a, i)               do {TRACE_EV(TEGRA_TRACE_EV_IRQ, tegra_trace_irq(a, i->n, 1)); qemu_irq_raise(i);} while (0)
+#define TRACE_IRQ_LOWER(a, i)               do {TRACE_EV(TEGRA_TRACE_EV_IRQ, tegra_trace_irq(a, i->n, 0)); qemu_irq_lower(i);} while (0)
+#define TRACE_IRQ_SET(a, i, v)              do {TRACE_EV(TEGRA_TRACE_EV_IRQ, tegra_trace_irq(a, (i)->n, v)); qemu_set_irq(i,v);} while (0)
+#define TPRINT(f, ...)                      do {static tegra_trace_fmt tprint_fmt_ = { .fmt = f }; TRACE_EV(TEGRA_TRACE_EV_TXT, tegra_trace_text_message(&tprint_fmt_, ## __VA_ARGS__));} while (0)
+#define TRACE_CDMA(d, g, c)                 TRACE_EV(TEGRA_TRACE_EV_CDMA, tegra_trace_cdma(d, g, c))
+#define TRACE_CDMA_START(c)                 TRACE_EV(TEGRA_TRACE_EV_CDMA, tegra_trace_cdma(0xA << 28, 0, c))
+#define TRACE_CDMA_STOP(c)                  TRACE_EV(TEGRA_TRACE_EV_CDMA, tegra_trace_cdma(0xB << 28, 0, c))
 
 int tegra_send_all(int fd, const void *_buf, int len1);
 
@@ -96,4 +130,25 @@ void tegra_trace_cdma(uint32_t data, uint32_t is_gather, uint32_t ch_id);
 
 void tegra_trace_init(void);
 
-void tegra_trace_text_message(const char* format, ...);
+void tegra_trace_text_message(tegra_trace_fmt *fmt, ...);
+
+const char *tegra_trace_fmt_get(uint32_t id);
+
+void tegra_trace_set_events(bool has_device, uint32_t device,
+                            uint32_t events, bool enable, Error **errp);
+
+void tegra_trace_record(const void *pkt, uint32_t len, uint32_t hwaddr,
+                        uint64_t time, uint32_t cpu_id);
+
+void tegra_trace_record_start(const char *path, Error **errp);
+
+void tegra_trace_record_stop(void);
+
+char *tegra_trace_record_path(void);
+
+void tegra_trace_record_init(void);
+
+/* memory_region_init_io() that gathers access statistics of the region.  */
+void tegra_mmio_init_io(MemoryRegion *mr, Object *owner,
+                        const MemoryRegionOps *ops, void *opaque,
+                        const char *name, uint64_t size);
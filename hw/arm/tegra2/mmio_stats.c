@@ -0,0 +1,259 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * MMIO access statistics.
+ *
+ * Devices create their "tegra.*" IO regions with tegra_mmio_init_io(), that
+ * hands wrapped ops to the memory API.  Accesses are counted per register
+ * and every TEGRA_MMIO_SAMPLE_PERIOD'th access of a device is timed into a
+ * log2 latency histogram.  A few regions, such as TIMERUS, are accessed
+ * without the BQL, hence atomic counters.
+ */
+
+#include "tegra_common.h"
+
+#include "exec/memory.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-tegra-target.h"
+#include "qemu/stats64.h"
+#include "qemu/timer.h"
+
+#include "tegra_trace.h"
+
+#define TEGRA_MMIO_SAMPLE_PERIOD    16
+#define TEGRA_MMIO_MAX_SLOTS        4096
+#define TEGRA_MMIO_HIST_BUCKETS     32
+
+typedef struct tegra_mmio_dev {
+    MemoryRegion *mr;
+    hwaddr base;
+
+    const MemoryRegionOps *ops;
+    void *opaque;
+    MemoryRegionOps wrap_ops;
+
+    Stat64 reads;
+    Stat64 writes;
+    uint32_t rd_seq;
+    uint32_t wr_seq;
+
+    /* Per register counters, offset >> shift */
+    unsigned shift;
+    uint32_t nr_slots;
+    uint32_t *rd_cnt;
+    uint32_t *wr_cnt;
+
+    Stat64 lat_samples;
+    Stat64 lat_total;
+    Stat64 lat_max;
+    Stat64 lat_hist[TEGRA_MMIO_HIST_BUCKETS];
+} tegra_mmio_dev;
+
+static GPtrArray *mmio_devs;
+
+static void tegra_mmio_sample(tegra_mmio_dev *d, int64_t start)
+{
+    uint64_t ns = get_clock() - start;
+    int bucket = ns ? 63 - clz64(ns) : 0;
+
+    stat64_add(&d->lat_samples, 1);
+    stat64_add(&d->lat_total, ns);
+    stat64_max(&d->lat_max, ns);
+    stat64_add(&d->lat_hist[MIN(bucket, TEGRA_MMIO_HIST_BUCKETS - 1)], 1);
+}
+
+static uint64_t tegra_mmio_stats_read(void *opaque, hwaddr offset,
+                                      unsigned size)
+{
+    tegra_mmio_dev *d = opaque;
+    uint64_t ret;
+    int64_t start;
+
+    qatomic_inc(&d->rd_cnt[offset >> d->shift]);
+    stat64_add(&d->reads, 1);
+
+    if (qatomic_fetch_inc(&d->rd_seq) % TEGRA_MMIO_SAMPLE_PERIOD)
+        return d->ops->read(d->opaque, offset, size);
+
+    start = get_clock();
+    ret = d->ops->read(d->opaque, offset, size);
+    tegra_mmio_sample(d, start);
+
+    return ret;
+}
+
+static void tegra_mmio_stats_write(void *opaque, hwaddr offset,
+                                   uint64_t value, unsigned size)
+{
+    tegra_mmio_dev *d = opaque;
+    int64_t start;
+
+    qatomic_inc(&d->wr_cnt[offset >> d->shift]);
+    stat64_add(&d->writes, 1);
+
+    if (qatomic_fetch_inc(&d->wr_seq) % TEGRA_MMIO_SAMPLE_PERIOD) {
+        d->ops->write(d->opaque, offset, value, size);
+        return;
+    }
+
+    start = get_clock();
+    d->ops->write(d->opaque, offset, value, size);
+    tegra_mmio_sample(d, start);
+}
+
+/* memory_region_init_io() of the Tegra devices, counts the accesses.  */
+void tegra_mmio_init_io(MemoryRegion *mr, Object *owner,
+                        const MemoryRegionOps *ops, void *opaque,
+                        const char *name, uint64_t size)
+{
+    tegra_mmio_dev *d;
+
+    /* Wrapper would see the wrong opaque in the accepts() callback.  */
+    if (!ops->read || !ops->write || ops->valid.accepts) {
+        memory_region_init_io(mr, owner, ops, opaque, name, size);
+        return;
+    }
+
+    d = g_new0(tegra_mmio_dev, 1);
+    d->mr = mr;
+    d->ops = ops;
+    d->opaque = opaque;
+
+    d->shift = 2;
+    while (DIV_ROUND_UP(size, 1ULL << d->shift) > TEGRA_MMIO_MAX_SLOTS)
+        d->shift++;
+
+    d->nr_slots = DIV_ROUND_UP(size, 1ULL << d->shift);
+    d->rd_cnt = g_new0(uint32_t, d->nr_slots);
+    d->wr_cnt = g_new0(uint32_t, d->nr_slots);
+
+    d->wrap_ops = *ops;
+    d->wrap_ops.read = tegra_mmio_stats_read;
+    d->wrap_ops.write = tegra_mmio_stats_write;
+
+    memory_region_init_io(mr, owner, &d->wrap_ops, d, name, size);
+
+    if (!mmio_devs)
+        mmio_devs = g_ptr_array_new();
+
+    g_ptr_array_add(mmio_devs, d);
+}
+
+/* Address of the region in the address space it is mapped to.  */
+static hwaddr tegra_mmio_base(MemoryRegion *mr)
+{
+    hwaddr base = 0;
+
+    for (; mr; mr = mr->container)
+        base += mr->addr;
+
+    return base;
+}
+
+static gint tegra_mmio_dev_cmp(gconstpointer a, gconstpointer b)
+{
+    const tegra_mmio_dev *da = *(const tegra_mmio_dev **) a;
+    const tegra_mmio_dev *db = *(const tegra_mmio_dev **) b;
+
+    return da->base < db->base ? -1 : da->base > db->base;
+}
+
+TegraMmioStatsList *qmp_query_tegra_mmio(bool has_reset, bool reset,
+                                         Error **errp)
+{
+    TegraMmioStatsList *list = NULL;
+    int i, j;
+
+    if (!mmio_devs) {
+        error_setg(errp, "Tegra MMIO statistics are not available on "
+                   "this machine");
+        return NULL;
+    }
+
+    for (i = 0; i < mmio_devs->len; i++) {
+        tegra_mmio_dev *d = g_ptr_array_index(mmio_devs, i);
+
+        d->base = tegra_mmio_base(d->mr);
+    }
+
+    g_ptr_array_sort(mmio_devs, tegra_mmio_dev_cmp);
+
+    for (i = mmio_devs->len - 1; i >= 0; i--) {
+        tegra_mmio_dev *d = g_ptr_array_index(mmio_devs, i);
+        TegraMmioStats *st;
+        uint64_t samples;
+
+        /* Not mapped anywhere.  */
+        if (!d->mr->container)
+            continue;
+
+        st = g_new0(TegraMmioStats, 1);
+        samples = stat64_get(&d->lat_samples);
+
+        st->name = g_strdup(memory_region_name(d->mr));
+        st->base = d->base;
+        st->size = memory_region_size(d->mr);
+        st->reads = stat64_get(&d->reads);
+        st->writes = stat64_get(&d->writes);
+        st->latency_samples = samples;
+        st->latency_avg_ns = samples ? stat64_get(&d->lat_total) / samples : 0;
+        st->latency_max_ns = stat64_get(&d->lat_max);
+
+        for (j = TEGRA_MMIO_HIST_BUCKETS - 1; j >= 0; j--) {
+            QAPI_LIST_PREPEND(st->latency_histogram,
+                              stat64_get(&d->lat_hist[j]));
+        }
+
+        for (j = d->nr_slots - 1; j >= 0; j--) {
+            uint32_t rd = qatomic_read(&d->rd_cnt[j]);
+            uint32_t wr = qatomic_read(&d->wr_cnt[j]);
+            TegraMmioRegStats *reg;
+
+            if (!rd && !wr)
+                continue;
+
+            reg = g_new0(TegraMmioRegStats, 1);
+            reg->offset = (uint64_t) j << d->shift;
+            reg->reads = rd;
+            reg->writes = wr;
+            QAPI_LIST_PREPEND(st->registers, reg);
+        }
+
+        QAPI_LIST_PREPEND(list, st);
+
+        if (has_reset && reset) {
+            stat64_init(&d->reads, 0);
+            stat64_init(&d->writes, 0);
+            stat64_init(&d->lat_samples, 0);
+            stat64_init(&d->lat_total, 0);
+            stat64_init(&d->lat_max, 0);
+
+            for (j = 0; j < TEGRA_MMIO_HIST_BUCKETS; j++)
+                stat64_init(&d->lat_hist[j], 0);
+
+            for (j = 0; j < d->nr_slots; j++) {
+                qatomic_set(&d->rd_cnt[j], 0);
+                qatomic_set(&d->wr_cnt[j], 0);
+            }
+        }
+    }
+
+    return list;
+}
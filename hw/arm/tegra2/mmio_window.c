@@ -0,0 +1,43 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tegra_common.h"
+
+#include "mmio_window.h"
+
+static int tegra_mmio_window_cmp(const void *a, const void *b)
+{
+    const tegra_mmio_window *wa = a, *wb = b;
+
+    return wa->start < wb->start ? -1 : wa->start > wb->start;
+}
+
+void tegra_mmio_windows_init(tegra_mmio_windows *w,
+                             const tegra_mmio_window *table, unsigned nr)
+{
+    unsigned i;
+
+    w->win = g_memdup(table, nr * sizeof(*table));
+    w->nr = nr;
+
+    qsort(w->win, nr, sizeof(*w->win), tegra_mmio_window_cmp);
+
+    for (i = 1; i < nr; i++)
+        g_assert(w->win[i - 1].start + w->win[i - 1].size <= w->win[i].start);
+}
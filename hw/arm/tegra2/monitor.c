@@ -0,0 +1,235 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tegra_common.h"
+
+#include "monitor/hmp.h"
+#include "monitor/hmp-target.h"
+#include "monitor/monitor.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-tegra-target.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/util.h"
+
+static void hmp_print_trace_events(Monitor *mon, TegraTraceEventList *events)
+{
+    TegraTraceEventList *ev;
+
+    if (!events) {
+        monitor_printf(mon, " none");
+    }
+
+    for (ev = events; ev; ev = ev->next) {
+        monitor_printf(mon, " %s", TegraTraceEvent_str(ev->value));
+    }
+
+    monitor_printf(mon, "\n");
+}
+
+void hmp_tegra_trace_set(Monitor *mon, const QDict *qdict)
+{
+    const char *events = qdict_get_str(qdict, "events");
+    bool enable = qdict_get_bool(qdict, "option");
+    bool has_device = qdict_haskey(qdict, "device");
+    uint32_t device = qdict_get_try_int(qdict, "device", 0);
+    TegraTraceEventList *list = NULL;
+    Error *err = NULL;
+    gchar **names;
+    int i, ev;
+
+    names = g_strsplit(events, ",", -1);
+
+    for (i = 0; names[i] && !err; i++) {
+        if (!strcmp(names[i], "all")) {
+            for (ev = 0; ev < TEGRA_TRACE_EVENT__MAX; ev++) {
+                QAPI_LIST_PREPEND(list, ev);
+            }
+            continue;
+        }
+
+        ev = qapi_enum_parse(&TegraTraceEvent_lookup, names[i], -1, &err);
+        if (ev >= 0) {
+            QAPI_LIST_PREPEND(list, ev);
+        }
+    }
+
+    g_strfreev(names);
+
+    if (!err) {
+        qmp_tegra_trace_set(list, enable, has_device, device, &err);
+    }
+
+    qapi_free_TegraTraceEventList(list);
+    hmp_handle_error(mon, err);
+}
+
+void hmp_tegra_trace_record(Monitor *mon, const QDict *qdict)
+{
+    bool enable = qdict_get_bool(qdict, "option");
+    const char *file = qdict_get_try_str(qdict, "file");
+    Error *err = NULL;
+
+    qmp_tegra_trace_record(enable, !!file, file, &err);
+    hmp_handle_error(mon, err);
+}
+
+void hmp_info_tegra_trace(Monitor *mon, const QDict *qdict)
+{
+    TegraTraceDeviceInfoList *dev;
+    TegraTraceInfo *info;
+    Error *err = NULL;
+
+    info = qmp_query_tegra_trace(&err);
+    if (err) {
+        hmp_handle_error(mon, err);
+        return;
+    }
+
+    monitor_printf(mon, "viewer: %s\n",
+                   info->connected ? "connected" : "not connected");
+    monitor_printf(mon, "recording: %s\n",
+                   info->has_record_file ? info->record_file : "off");
+    monitor_printf(mon, "events:");
+    hmp_print_trace_events(mon, info->events);
+
+    for (dev = info->devices; dev; dev = dev->next) {
+        monitor_printf(mon, "  0x%08x:", dev->value->device);
+        hmp_print_trace_events(mon, dev->value->events);
+    }
+
+    qapi_free_TegraTraceInfo(info);
+}
+
+#define HMP_MMIO_TOP_REGS   8
+
+static gint hmp_mmio_reg_cmp(gconstpointer a, gconstpointer b)
+{
+    const TegraMmioRegStats *ra = *(const TegraMmioRegStats **) a;
+    const TegraMmioRegStats *rb = *(const TegraMmioRegStats **) b;
+    uint64_t ta = ra->reads + ra->writes;
+    uint64_t tb = rb->reads + rb->writes;
+
+    return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+void hmp_info_tegra_mmio(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    TegraMmioStatsList *list, *dev;
+    TegraMmioRegStatsList *reg;
+    Error *err = NULL;
+    GPtrArray *regs;
+    guint i;
+
+    list = qmp_query_tegra_mmio(true, reset, &err);
+    if (err) {
+        hmp_handle_error(mon, err);
+        return;
+    }
+
+    for (dev = list; dev; dev = dev->next) {
+        TegraMmioStats *st = dev->value;
+
+        if (!st->reads && !st->writes)
+            continue;
+
+        monitor_printf(mon, "%-24s 0x%08" PRIx64 ": %" PRIu64 " reads, %"
+                       PRIu64 " writes, latency avg %" PRIu64 " ns max %"
+                       PRIu64 " ns\n", st->name, st->base, st->reads,
+                       st->writes, st->latency_avg_ns, st->latency_max_ns);
+
+        regs = g_ptr_array_new();
+        for (reg = st->registers; reg; reg = reg->next) {
+            g_ptr_array_add(regs, reg->value);
+        }
+        g_ptr_array_sort(regs, hmp_mmio_reg_cmp);
+
+        for (i = 0; i < MIN(regs->len, HMP_MMIO_TOP_REGS); i++) {
+            TegraMmioRegStats *r = g_ptr_array_index(regs, i);
+
+            monitor_printf(mon, "    +0x%03" PRIx64 ": %" PRIu64 " reads, %"
+                           PRIu64 " writes\n", r->offset, r->reads, r->writes);
+        }
+
+        g_ptr_array_free(regs, true);
+    }
+
+    qapi_free_TegraMmioStatsList(list);
+}
+
+void hmp_info_tegra_cdma(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    TegraCdmaStatsList *list, *ch;
+    Error *err = NULL;
+
+    list = qmp_query_tegra_cdma(true, reset, &err);
+    if (err) {
+        hmp_handle_error(mon, err);
+        return;
+    }
+
+    for (ch = list; ch; ch = ch->next) {
+        TegraCdmaStats *st = ch->value;
+        TegraCdmaOpcodeStats *op = st->opcodes;
+
+        monitor_printf(mon, "channel %u%s%s: %" PRIu64 " words, %" PRIu64
+                       " gathers, queue depth %u, %" PRIu64 " slices\n",
+                       st->channel, st->enabled ? "" : " (disabled)",
+                       st->high_priority ? " (high priority)" : "",
+                       st->words, st->gathers, st->queue_depth, st->slices);
+        monitor_printf(mon, "    setcl %" PRIu64 " incr %" PRIu64
+                       " nonincr %" PRIu64 " mask %" PRIu64 " imm %" PRIu64
+                       " restart %" PRIu64 " gather %" PRIu64
+                       " extend %" PRIu64 " chdone %" PRIu64 "\n",
+                       op->setcl, op->incr, op->nonincr, op->mask, op->imm,
+                       op->restart, op->gather, op->extend, op->chdone);
+        monitor_printf(mon, "    syncpt wait %" PRIu64 " us, mlock wait %"
+                       PRIu64 " us, BQL held %" PRIu64 " us\n",
+                       st->syncpt_wait_ns / 1000, st->mlock_wait_ns / 1000,
+                       st->bql_hold_ns / 1000);
+    }
+
+    qapi_free_TegraCdmaStatsList(list);
+}
+
+void hmp_info_tegra_cpu_idle(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    TegraCpuIdleStatsList *list, *cpu;
+    Error *err = NULL;
+
+    list = qmp_query_tegra_cpu_idle(true, reset, &err);
+    if (err) {
+        hmp_handle_error(mon, err);
+        return;
+    }
+
+    for (cpu = list; cpu; cpu = cpu->next) {
+        TegraCpuIdleStats *st = cpu->value;
+
+        monitor_printf(mon, "cpu %u%s: %" PRIu64 " wfe, %" PRIu64
+                       " sleeps, woken by irq %" PRIu64 " sev %" PRIu64
+                       " flow %" PRIu64 "\n",
+                       st->cpu, st->parked ? " (parked)" : "", st->wfe,
+                       st->sleeps, st->wake_irq, st->wake_sev, st->wake_flow);
+    }
+
+    qapi_free_TegraCpuIdleStatsList(list);
+}
@@ -988,8 +988,8 @@ static void tegra_apb_misc_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_apb_misc *s = TEGRA_APB_MISC(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_apb_misc_mem_ops, s,
-                          "tegra.apb_misc", TEGRA_APB_MISC_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_apb_misc_mem_ops, s,
+                       "tegra.apb_misc", TEGRA_APB_MISC_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -175,8 +175,8 @@ static void tegra_arb_sema_priv_realize(DeviceState *dev, Error **errp)
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cop);
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cpu);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_arb_sema_mem_ops, s,
-                          "tegra.arb_sema", TEGRA_ARB_SEMA_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_arb_sema_mem_ops, s,
+                       "tegra.arb_sema", TEGRA_ARB_SEMA_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
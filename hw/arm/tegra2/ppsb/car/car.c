@@ -1342,8 +1342,8 @@ static void tegra_car_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_car *s = TEGRA_CAR(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_car_mem_ops, s,
-                          "tegra.car", TEGRA_CLK_RESET_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_car_mem_ops, s,
+                       "tegra.car", TEGRA_CLK_RESET_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
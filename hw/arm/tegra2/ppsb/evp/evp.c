@@ -232,8 +232,8 @@ static void tegra_evp_priv_realize(DeviceState *dev, Error **errp)
     CPUState *cs = qemu_get_cpu(TEGRA2_COP);
     ARMCPU *cpu = ARM_CPU(cs);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_evp_mem_ops, s,
-                          "tegra.evp", TEGRA_EXCEPTION_VECTORS_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_evp_mem_ops, s,
+                       "tegra.evp", TEGRA_EXCEPTION_VECTORS_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     /* FIXME: lame */
@@ -102,7 +102,6 @@ static int tegra_flow_have_pending_irq(int cpu_id)
 {
     A9MPPrivState *a9mpcore = A9MPCORE_PRIV(tegra_a9mpcore_dev);
     GICState *s = &a9mpcore->gic;
-    int i;
 
     if (tegra_ictlr_is_irq_pending_on_cpu(cpu_id)) {
         return 1;
@@ -112,14 +111,9 @@ static int tegra_flow_have_pending_irq(int cpu_id)
         return 0;
     }
 
-    for (i = INT_CPU_IRQS_NR; i < INT_GIC_NR; i++) {
-        if (!GIC_DIST_TEST_ENABLED(i, 1 << cpu_id))
-            continue;
-
-        if (gic_test_pending(s, i, 1 << cpu_id)) {
-            TPRINT("tegra_flow: irq %d pending\n", i);
-            return 1;
-        }
+    if (gic_cpu_has_spi_pending(s, cpu_id)) {
+        TPRINT("tegra_flow: SPI pending on CPU%d\n", cpu_id);
+        return 1;
     }
 
     return 0;
@@ -662,8 +656,8 @@ static void tegra_flow_priv_realize(DeviceState *dev, Error **errp)
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cpu_event);
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cop_event);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_flow_mem_ops, s,
-                          "tegra.flow", TEGRA_FLOW_CTRL_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_flow_mem_ops, s,
+                       "tegra.flow", TEGRA_FLOW_CTRL_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     for (i = 0; i < TEGRA2_NCPUS; i++) {
@@ -270,8 +270,8 @@ static void tegra_gpio_priv_realize(DeviceState *dev, Error **errp)
     tegra_gpio *s = TEGRA_GPIO(dev);
     int i;
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_gpio_mem_ops, s,
-                          "tegra.gpio", TEGRA_GPIO_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_gpio_mem_ops, s,
+                       "tegra.gpio", TEGRA_GPIO_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     for (i = 0; i < BANKS_NB; i++)
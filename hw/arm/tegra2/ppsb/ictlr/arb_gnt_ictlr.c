@@ -121,8 +121,8 @@ static void tegra_arb_gnt_ictlr_realize(DeviceState *dev, Error **errp)
     tegra_arb_gnt_ictlr *s = TEGRA_ARBGNT_ICTLR(dev);
     SysBusDevice *sbd = SYS_BUS_DEVICE(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &tegra_arb_gnt_ictlr_mem_ops, s,
-                          "tegra.arb_gnt_ictlr", TEGRA_ARBGNT_ICTLR_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &tegra_arb_gnt_ictlr_mem_ops, s,
+                       "tegra.arb_gnt_ictlr", TEGRA_ARBGNT_ICTLR_SIZE);
     sysbus_init_mmio(sbd, &s->iomem);
 }
 
@@ -30,10 +30,36 @@
 #include "tegra_cpu.h"
 #include "tegra_trace.h"
 
+static void tegra_ictlr_update_pending(uint8_t *banks, uint32_t *virq,
+                                       int is_fiq)
+{
+    int bank;
+
+    for (bank = 0; bank < 4; bank++) {
+        if (virq[bank])
+            *banks |= 1 << (bank + is_fiq * 4);
+        else
+            *banks &= ~(1 << (bank + is_fiq * 4));
+    }
+}
+
+static int tegra_ictlr_post_load(void *opaque, int version_id)
+{
+    tegra_ictlr *s = opaque;
+
+    tegra_ictlr_update_pending(&s->cpu_pending_banks, s->virq_cpu, 0);
+    tegra_ictlr_update_pending(&s->cpu_pending_banks, s->vfiq_cpu, 1);
+    tegra_ictlr_update_pending(&s->cop_pending_banks, s->virq_cop, 0);
+    tegra_ictlr_update_pending(&s->cop_pending_banks, s->vfiq_cop, 1);
+
+    return 0;
+}
+
 static const VMStateDescription vmstate_tegra_ictlr = {
     .name = "tegra.ictlr",
     .version_id = 1,
     .minimum_version_id = 1,
+    .post_load = tegra_ictlr_post_load,
     .fields = (VMStateField[]) {
         VMSTATE_UINT32_ARRAY(virq_cpu, tegra_ictlr, 4),
         VMSTATE_UINT32_ARRAY(virq_cop, tegra_ictlr, 4),
@@ -49,48 +75,26 @@ static const VMStateDescription vmstate_tegra_ictlr = {
     }
 };
 
-static int tegra_ictlr_is_irq_pending(tegra_ictlr *s, uint32_t *reg, int fiq)
-{
-    int i;
-
-    for (i = 0; i < 4; i++) {
-        if (reg[i]) {
-//             TPRINT("%s bank=%d %s reg=0x%08X\n",
-//                    __func__, i, fiq ? "FIQ" : "IRQ", reg[i]);
-            return 1;
-        }
-    }
-
-    return 0;
-}
-
 int tegra_ictlr_is_irq_pending_on_cpu(int cpu_id)
 {
     tegra_ictlr *s = tegra_ictlr_dev;
-    int ret = 0;
 
     assert(tegra_ictlr_dev != NULL);
 
     switch (cpu_id) {
     case TEGRA2_A9_CORE0:
     case TEGRA2_A9_CORE1:
-        ret |= tegra_ictlr_is_irq_pending(s, s->virq_cpu, 0);
-        ret |= tegra_ictlr_is_irq_pending(s, s->vfiq_cpu, 1);
-        break;
+        return !!s->cpu_pending_banks;
     case TEGRA2_COP:
-        ret |= tegra_ictlr_is_irq_pending(s, s->virq_cop, 0);
-        ret |= tegra_ictlr_is_irq_pending(s, s->vfiq_cop, 1);
-        break;
+        return !!s->cop_pending_banks;
     default:
         g_assert_not_reached();
     }
-
-    return ret;
 }
 
 static void tegra_ictlr_update_irq(tegra_ictlr *s, uint32_t *virq, uint32_t *ier,
                                    uint32_t *iep, int is_fiq, qemu_irq irq,
-                                   int bank)
+                                   uint8_t *banks, int bank)
 {
     uint32_t new_sts, old_sts;
     int old_irq_lvl = !!(virq[0] | virq[1] | virq[2] | virq[3]);
@@ -110,6 +114,11 @@ static void tegra_ictlr_update_irq(tegra_ictlr *s, uint32_t *virq, uint32_t *ier
     /* Some bit changed, update valid IRQ's status register.  */
     virq[bank] = new_sts;
 
+    if (new_sts)
+        *banks |= 1 << (bank + is_fiq * 4);
+    else
+        *banks &= ~(1 << (bank + is_fiq * 4));
+
     if (!!old_sts == !!new_sts) {
         /* Bank IRQ level state not changed.  */
         return;
@@ -141,16 +150,16 @@ static void tegra_ictlr_update_irq(tegra_ictlr *s, uint32_t *virq, uint32_t *ier
 static void tegra_ictlr_update_irqs(tegra_ictlr *s, int bank)
 {
     tegra_ictlr_update_irq(s, s->virq_cpu, s->cpu_ier, s->cpu_iep_class,
-                           0, s->cpu_irq, bank);
+                           0, s->cpu_irq, &s->cpu_pending_banks, bank);
 
     tegra_ictlr_update_irq(s, s->vfiq_cpu, s->cpu_ier, s->cpu_iep_class,
-                           1, s->cpu_fiq, bank);
+                           1, s->cpu_fiq, &s->cpu_pending_banks, bank);
 
     tegra_ictlr_update_irq(s, s->virq_cop, s->cop_ier, s->cop_iep_class,
-                           0, s->cop_irq, bank);
+                           0, s->cop_irq, &s->cop_pending_banks, bank);
 
     tegra_ictlr_update_irq(s, s->vfiq_cop, s->cop_ier, s->cop_iep_class,
-                           1, s->cop_fiq, bank);
+                           1, s->cop_fiq, &s->cop_pending_banks, bank);
 }
 
 static void tegra_ictlr_irq_handler(void *opaque, int irq, int level)
@@ -295,6 +304,9 @@ static void tegra_ictlr_reset(DeviceState *dev)
     memset(s->cpu_iep_class, 0, sizeof(s->cpu_iep_class));
     memset(s->cop_ier, 0, sizeof(s->cop_ier));
     memset(s->cop_iep_class, 0, sizeof(s->cop_iep_class));
+
+    s->cpu_pending_banks = 0;
+    s->cop_pending_banks = 0;
 }
 
 static void tegra_ictlr_realize(DeviceState *dev, Error **errp)
@@ -322,8 +334,8 @@ static void tegra_ictlr_init(Object *obj)
     object_initialize_child(obj, "arb_gnt_ictlr", &s->arb_gnt_ictlr,
                             TYPE_TEGRA_ARBGNT_ICTLR);
 
-    memory_region_init_io(&s->iomem, obj, &tegra_ictlr_mem_ops, s,
-                          "tegra.ictlr", 0x400);
+    tegra_mmio_init_io(&s->iomem, obj, &tegra_ictlr_mem_ops, s,
+                       "tegra.ictlr", 0x400);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
 
     tegra_arb_gnt_ictlr_dev = &s->arb_gnt_ictlr;
@@ -67,8 +67,8 @@ static void tegra_pg_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_pg *s = TEGRA_PG(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_pg_mem_ops, s,
-                          "tegra.pg", SZ_4K);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_pg_mem_ops, s,
+                       "tegra.pg", SZ_4K);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
@@ -193,8 +193,8 @@ static void tegra_res_sema_priv_realize(DeviceState *dev, Error **errp)
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cop_outbox_full);
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq_cpu_outbox_empty);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_res_sema_mem_ops, s,
-                          "tegra.res_sema", TEGRA_RES_SEMA_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_res_sema_mem_ops, s,
+                       "tegra.res_sema", TEGRA_RES_SEMA_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
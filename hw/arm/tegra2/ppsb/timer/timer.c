@@ -155,8 +155,8 @@ static void tegra_timer_priv_realize(DeviceState *dev, Error **errp)
 
     sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_timer_mem_ops, s,
-                          "tegra.timer", 0x8);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_timer_mem_ops, s,
+                       "tegra.timer", 0x8);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
     s->ptimer = ptimer_init(tegra_timer_alarm, s, PTIMER_POLICY);
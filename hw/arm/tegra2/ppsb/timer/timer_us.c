@@ -17,10 +17,17 @@
  *  with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * CNTR_1US is derived from the VIRTUAL clock, there is no timer behind it.
+ * Guests spin on it in udelay(), so the registers are accessed without the
+ * BQL and the counter parameters are published under a seqlock.
+ */
+
 #include "tegra_common.h"
 
-#include "hw/ptimer.h"
 #include "hw/sysbus.h"
+#include "qemu/host-utils.h"
+#include "qemu/timer.h"
 
 #include "timer_us.h"
 #include "iomap.h"
@@ -33,16 +40,49 @@
 
 static const VMStateDescription vmstate_tegra_timer_us = {
     .name = "tegra.timer_us",
-    .version_id = 1,
-    .minimum_version_id = 1,
+    .version_id = 2,
+    .minimum_version_id = 2,
     .fields = (VMStateField[]) {
-        VMSTATE_UINT32(cntr_1us.reg32, tegra_timer_us),
         VMSTATE_UINT32(usec_cfg.reg32, tegra_timer_us),
         VMSTATE_UINT32(cntr_freeze.reg32, tegra_timer_us),
+        VMSTATE_INT64(base_ns, tegra_timer_us),
+        VMSTATE_UINT32(cntr_base, tegra_timer_us),
+        VMSTATE_UINT32(freq, tegra_timer_us),
         VMSTATE_END_OF_LIST()
     }
 };
 
+static uint32_t tegra_timer_us_count(tegra_timer_us *s, int64_t now)
+{
+    return s->cntr_base + muldiv64(MAX(now - s->base_ns, 0), s->freq,
+                                   NANOSECONDS_PER_SECOND);
+}
+
+static uint32_t tegra_timer_us_cntr(tegra_timer_us *s)
+{
+    uint32_t cntr;
+    unsigned start;
+
+    do {
+        start = seqlock_read_begin(&s->seqlock);
+        cntr = tegra_timer_us_count(s, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    } while (seqlock_read_retry(&s->seqlock, start));
+
+    return cntr;
+}
+
+/* Rebases the counter, it keeps counting from the current value.  */
+void tegra_timer_us_set_freq(tegra_timer_us *s, uint32_t freq)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    seqlock_write_lock(&s->seqlock, &s->lock);
+    s->cntr_base = tegra_timer_us_count(s, now);
+    s->base_ns = now;
+    s->freq = freq;
+    seqlock_write_unlock(&s->seqlock, &s->lock);
+}
+
 static uint64_t tegra_timer_us_priv_read(void *opaque, hwaddr offset,
                                          unsigned size)
 {
@@ -51,14 +91,13 @@ static uint64_t tegra_timer_us_priv_read(void *opaque, hwaddr offset,
 
     switch (offset) {
     case CNTR_1US_OFFSET:
-        s->cntr_1us.reg32 = ~ptimer_get_count(s->ptimer);
-        ret = s->cntr_1us.reg32;
+        ret = tegra_timer_us_cntr(s);
         break;
     case USEC_CFG_OFFSET:
-        ret = s->usec_cfg.reg32;
+        ret = qatomic_read(&s->usec_cfg.reg32);
         break;
     case CNTR_FREEZE_OFFSET:
-        ret = s->cntr_freeze.reg32;
+        ret = qatomic_read(&s->cntr_freeze.reg32);
         break;
     default:
         TRACE_READ(s->iomem.addr, offset, 0);
@@ -79,11 +118,11 @@ static void tegra_timer_us_priv_write(void *opaque, hwaddr offset,
     switch (offset) {
     case USEC_CFG_OFFSET:
         TRACE_WRITE(s->iomem.addr, offset, s->usec_cfg.reg32, value);
-        s->usec_cfg.reg32 = value;
+        qatomic_set(&s->usec_cfg.reg32, value);
         break;
     case CNTR_FREEZE_OFFSET:
         TRACE_WRITE(s->iomem.addr, offset, s->cntr_freeze.reg32, value);
-        s->cntr_freeze.reg32 = value;
+        qatomic_set(&s->cntr_freeze.reg32, value);
         break;
     default:
         TRACE_WRITE(s->iomem.addr, offset, 0, value);
@@ -96,11 +135,12 @@ static void tegra_timer_us_priv_reset(DeviceState *dev)
 {
     tegra_timer_us *s = TEGRA_TIMER_US(dev);
 
-    ptimer_transaction_begin(s->ptimer);
-    ptimer_run(s->ptimer, 0);
-    ptimer_transaction_commit(s->ptimer);
+    seqlock_write_lock(&s->seqlock, &s->lock);
+    s->base_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    s->cntr_base = CNTR_1US_RESET;
+    s->freq = 1000000 * SCALE;
+    seqlock_write_unlock(&s->seqlock, &s->lock);
 
-    s->cntr_1us.reg32 = CNTR_1US_RESET;
     s->usec_cfg.reg32 = USEC_CFG_RESET;
     s->cntr_freeze.reg32 = CNTR_FREEZE_RESET;
 }
@@ -111,24 +151,17 @@ static const MemoryRegionOps tegra_timer_us_mem_ops = {
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
-static void tegra_timer_us_tick(void *opaque)
-{
-    /* Nothing to do on timer rollover */
-}
-
 static void tegra_timer_us_priv_realize(DeviceState *dev, Error **errp)
 {
     tegra_timer_us *s = TEGRA_TIMER_US(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(dev), &tegra_timer_us_mem_ops, s,
-                          "tegra.timer_us", TEGRA_TMRUS_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(dev), &tegra_timer_us_mem_ops, s,
+                       "tegra.timer_us", TEGRA_TMRUS_SIZE);
+    memory_region_clear_global_locking(&s->iomem);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 
-    s->ptimer = ptimer_init(tegra_timer_us_tick, s, PTIMER_POLICY_DEFAULT);
-    ptimer_transaction_begin(s->ptimer);
-    ptimer_set_freq(s->ptimer, 1000000 * SCALE);
-    ptimer_set_limit(s->ptimer, 0xffffffff, 1);
-    ptimer_transaction_commit(s->ptimer);
+    seqlock_init(&s->seqlock);
+    qemu_spin_init(&s->lock);
 }
 
 static void tegra_timer_us_class_init(ObjectClass *klass, void *data)
@@ -22,6 +22,9 @@
 #ifndef TEGRA_TIMER_US_H
 #define TEGRA_TIMER_US_H
 
+#include "qemu/seqlock.h"
+#include "qemu/thread.h"
+
 #define CNTR_1US_OFFSET 0x0
 #define CNTR_1US_RESET  0x00000000
 typedef union cntr_1us_u {
@@ -65,10 +68,17 @@ typedef struct tegra_timer_us_state {
     SysBusDevice parent_obj;
 
     MemoryRegion iomem;
-    ptimer_state *ptimer;
-    DEFINE_REG32(cntr_1us);
     DEFINE_REG32(usec_cfg);
     DEFINE_REG32(cntr_freeze);
+
+    /* CNTR_1US counts at freq from cntr_base since base_ns.  */
+    QemuSeqLock seqlock;
+    QemuSpin lock;
+    int64_t base_ns;
+    uint32_t cntr_base;
+    uint32_t freq;
 } tegra_timer_us;
 
+void tegra_timer_us_set_freq(tegra_timer_us *s, uint32_t freq);
+
 #endif // TEGRA_TIMER_US_H
@@ -151,9 +151,9 @@ static void remote_iram_priv_realize(DeviceState *dev, Error **errp)
 {
     remote_iram *s = TEGRA_REMOTE_IRAM(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &remote_iram_iram_ops, s,
-                          "tegra.remote_iram",
-                          TEGRA_IRAM_SIZE - TEGRA_RESET_HANDLER_SIZE);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &remote_iram_iram_ops, s,
+                       "tegra.remote_iram",
+                       TEGRA_IRAM_SIZE - TEGRA_RESET_HANDLER_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
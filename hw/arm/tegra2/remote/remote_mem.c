@@ -187,8 +187,8 @@ static void remote_mem_priv_realize(DeviceState *dev, Error **errp)
 {
     remote_mem *s = TEGRA_REMOTE_MEM(dev);
 
-    memory_region_init_io(&s->iomem, OBJECT(s), &remote_mem_mem_ops, s,
-                          "tegra.remote_mem", SZ_256M);
+    tegra_mmio_init_io(&s->iomem, OBJECT(s), &remote_mem_mem_ops, s,
+                       "tegra.remote_mem", SZ_256M);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
 }
 
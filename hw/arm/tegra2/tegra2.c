@@ -246,6 +246,18 @@ static void load_memory_images(MachineState *machine)
     }
 }
 
+static bool tegra_idle_warp_enabled;
+
+static bool tegra2_get_idle_warp(Object *obj, Error **errp)
+{
+    return tegra_idle_warp_enabled;
+}
+
+static void tegra2_set_idle_warp(Object *obj, bool value, Error **errp)
+{
+    tegra_idle_warp_enabled = value;
+}
+
 static void tegra2_init(MachineState *machine)
 {
     MemoryRegion *cop_sysmem = g_new(MemoryRegion, 1);
@@ -256,6 +268,8 @@ static void tegra2_init(MachineState *machine)
     CPUState *cs;
     int i, j;
 
+    tegra_trace_init();
+
     /* Main RAM */
     assert(machine->ram_size <= TEGRA_DRAM_SIZE);
     memory_region_add_and_init_ram(sysmem, "tegra.dram",
@@ -520,6 +534,9 @@ static void tegra2_init(MachineState *machine)
     /* GPU 2d */
     tegra_gr2d_dev = sysbus_create_simple("tegra.gr2d", TEGRA_GR2D_BASE, NULL);
 
+    /* GPU 3d */
+    sysbus_create_simple("tegra.gr3d", TEGRA_GR3D_BASE, NULL);
+
     /* Display1 controller */
     tegra_dc1_dev = sysbus_create_simple("tegra.dc", TEGRA_DISPLAY_BASE,
                                          DIRQ(INT_DISPLAY_GENERAL));
@@ -624,12 +641,14 @@ static void tegra2_init(MachineState *machine)
     load_memory_images(machine);
 
     tegra_cpu_reset_init();
+
+    if (tegra_idle_warp_enabled)
+        tegra_idle_warp_init();
 }
 
 static void tegra2_reset(MachineState *state)
 {
 //     remote_io_init("10.1.1.3:45312");
-    tegra_trace_init();
     qemu_devices_reset();
 
     tegra_cpu_reset_deassert(TEGRA2_COP, 1);
@@ -644,6 +663,13 @@ static void __tegra2_machine_init(MachineClass *mc)
     mc->min_cpus = TEGRA2_NCPUS;
     mc->max_cpus = TEGRA2_NCPUS;
     mc->ignore_memory_transaction_failures = true;
+
+    object_class_property_add_bool(OBJECT_CLASS(mc), "idle-warp",
+                                   tegra2_get_idle_warp,
+                                   tegra2_set_idle_warp);
+    object_class_property_set_description(OBJECT_CLASS(mc), "idle-warp",
+        "Fast-forward the virtual clock to the next timer deadline "
+        "while all CPUs are idle");
 }
 
 enum tegra_board_type tegra_board;
@@ -22,7 +22,9 @@
 #include "tegra_common.h"
 
 #include "qapi/error.h"
+#include "qapi/qapi-commands-tegra-target.h"
 #include "qemu/error-report.h"
+#include "qemu/main-loop.h"
 #include "sysemu/sysemu.h"
 #include "hw/ptimer.h"
 #include "hw/sysbus.h"
@@ -34,12 +36,12 @@
 #include "ppsb/timer/timer_us.h"
 #include "ppsb/timer/timer.h"
 #include "devices.h"
+#include "iomap.h"
+#include "sizes.h"
 #include "tegra_trace.h"
 
 #define SOCKET_FILE     "/tmp/trace.sock"
 
-#define HOST1X_CDMA	0x1010
-
 #define PACKET_TRACE_RW 0x11111111
 #define PACKET_TRACE_RW_V2 0x11111112
 struct __attribute__((packed, aligned(1))) trace_pkt_rw {
@@ -66,16 +68,29 @@ struct __attribute__((packed, aligned(1))) trace_pkt_irq {
     uint64_t __pad;
 };
 
-#define PACKET_TRACE_TXT 0x33334444
-struct __attribute__((packed, aligned(1))) trace_pkt_txt {
+#define PACKET_TRACE_FMT 0x33335555
+struct __attribute__((packed, aligned(1))) trace_pkt_fmt {
     uint32_t magic;
+    uint32_t id;
     uint32_t text_sz;
     uint64_t __pad0;
     uint64_t __pad1;
     uint64_t __pad2;
-    uint32_t __pad4;
-//     uint32_t time;
-    char text[1]; // \0
+    char text[]; // \0
+};
+
+#define TRACE_TXT_ARGS_SIZE 256
+
+#define PACKET_TRACE_TXT_V2 0x33336666
+struct __attribute__((packed, aligned(1))) trace_pkt_txt {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t args_sz;
+    uint32_t time;
+    uint32_t cpu_id;
+    uint64_t __pad0;
+    uint64_t __pad1;
+    uint8_t args[TRACE_TXT_ARGS_SIZE];
 };
 
 #define PACKET_TRACE_CDMA 0x44445555
@@ -89,34 +104,45 @@ struct __attribute__((packed, aligned(1))) trace_pkt_cdma {
     uint64_t __pad1;
 };
 
+QEMU_BUILD_BUG_ON(sizeof(struct trace_pkt_rw) != TEGRA_TRACE_REC_SIZE);
+QEMU_BUILD_BUG_ON(sizeof(struct trace_pkt_irq) != TEGRA_TRACE_REC_SIZE);
+QEMU_BUILD_BUG_ON(sizeof(struct trace_pkt_cdma) != TEGRA_TRACE_REC_SIZE);
+QEMU_BUILD_BUG_ON(sizeof(struct trace_pkt_fmt) != TEGRA_TRACE_REC_SIZE);
+QEMU_BUILD_BUG_ON(offsetof(struct trace_pkt_txt, args) != TEGRA_TRACE_REC_SIZE);
+
+QEMU_BUILD_BUG_ON(TEGRA_TRACE_EV_RW != 1 << TEGRA_TRACE_EVENT_RW);
+QEMU_BUILD_BUG_ON(TEGRA_TRACE_EV_IRQ != 1 << TEGRA_TRACE_EVENT_IRQ);
+QEMU_BUILD_BUG_ON(TEGRA_TRACE_EV_TXT != 1 << TEGRA_TRACE_EVENT_TEXT);
+QEMU_BUILD_BUG_ON(TEGRA_TRACE_EV_CDMA != 1 << TEGRA_TRACE_EVENT_CDMA);
+QEMU_BUILD_BUG_ON(TEGRA_TRACE_EV_ALL != (1 << TEGRA_TRACE_EVENT__MAX) - 1);
+
+uint32_t tegra_trace_dstate;
+
+/* Events enabled for devices that have no override in trace_dev_events.  */
+static uint32_t trace_default_events;
+static GHashTable *trace_dev_events;
+static QemuMutex trace_mutex;
+
+/* Registered TPRINT formats, ID is the index + 1.  */
+static GPtrArray *trace_fmts;
+static QemuMutex fmt_mutex;
+
+static int listen_sock = -1;
 static int msgsock = -1;
+static unsigned int msgsock_gen;
 static QemuMutex send_mutex;
 
-int tegra_send_all(int fd, const void *_buf, int len1)
+/* Caller must hold send_mutex.  */
+static int tegra_send_all_locked(int fd, const void *_buf, int len1)
 {
-    int ret, len;
-    const uint8_t *buf;
-    bool try_again = true;
+    const uint8_t *buf = _buf;
+    int ret, len = len1;
 
-    if (msgsock == -1)
-        return 0;
-
-    qemu_mutex_lock(&send_mutex);
-retry:
-    buf = _buf;
-    len = len1;
     while (len > 0) {
         ret = write(fd, buf, len);
         if (ret < 0) {
-            if (errno != EINTR && errno != EAGAIN) {
-                if (try_again) {
-                    tegra_trace_init();
-                    try_again = false;
-                    goto retry;
-                }
-                qemu_mutex_unlock(&send_mutex);
+            if (errno != EINTR && errno != EAGAIN)
                 return -1;
-            }
         } else if (ret == 0) {
             break;
         } else {
@@ -124,10 +150,75 @@ retry:
             len -= ret;
         }
     }
-    qemu_mutex_unlock(&send_mutex);
+
     return len1 - len;
 }
 
+int tegra_send_all(int fd, const void *_buf, int len1)
+{
+    int ret;
+
+    qemu_mutex_lock(&send_mutex);
+    ret = tegra_send_all_locked(fd, _buf, len1);
+    qemu_mutex_unlock(&send_mutex);
+
+    return ret;
+}
+
+/*
+ * The viewer socket is only sent to, replaced and closed under send_mutex,
+ * so a sender never writes to a closed and reused fd.  The cmd thread reads
+ * from a dup of it, shutting the socket down wakes the thread up.
+ */
+static void trace_viewer_close_locked(int fd)
+{
+    msgsock_gen++;
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+}
+
+static int tegra_trace_send(const void *buf, int len)
+{
+    int fd, ret = 0;
+
+    if (qatomic_read(&msgsock) == -1)
+        return 0;
+
+    qemu_mutex_lock(&send_mutex);
+
+    fd = qatomic_read(&msgsock);
+    if (fd != -1) {
+        ret = tegra_send_all_locked(fd, buf, len);
+
+        if (ret < 0) {
+            /* Viewer has gone, wait for the next one in background.  */
+            qatomic_set(&msgsock, -1);
+            trace_viewer_close_locked(fd);
+        }
+    }
+
+    qemu_mutex_unlock(&send_mutex);
+
+    return ret;
+}
+
+static uint32_t tegra_trace_dev_events(uint32_t hwaddr)
+{
+    uint32_t events;
+    gpointer val;
+
+    qemu_mutex_lock(&trace_mutex);
+    if (g_hash_table_lookup_extended(trace_dev_events,
+                                     GUINT_TO_POINTER(hwaddr), NULL, &val)) {
+        events = GPOINTER_TO_UINT(val);
+    } else {
+        events = trace_default_events;
+    }
+    qemu_mutex_unlock(&trace_mutex);
+
+    return events;
+}
+
 int tegra_recv_all(int fd, void *_buf, int len1, bool single_read)
 {
     int ret, len;
@@ -151,41 +242,219 @@ int tegra_recv_all(int fd, void *_buf, int len1, bool single_read)
     return len1 - len;
 }
 
-void tegra_trace_text_message(const char* format, ...)
+static uint32_t tegra_trace_cpu_id(void)
+{
+    CPUState *cs = CPU(current_cpu);
+
+    if (host1x_cdma_ptr)
+        return TEGRA_TRACE_CPU_CDMA;
+
+    return cs ? cs->cpu_index : 0xFF;
+}
+
+static void trace_fmt_add_arg(tegra_trace_fmt *fmt, uint8_t type)
+{
+    if (fmt->nargs < TEGRA_TRACE_FMT_MAX_ARGS)
+        fmt->args[fmt->nargs++] = type;
+}
+
+static void trace_fmt_parse(tegra_trace_fmt *fmt)
+{
+    const char *p = fmt->fmt;
+    int lng;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        if (*++p == '%') {
+            p++;
+            continue;
+        }
+
+        /* Flags, width and precision.  */
+        for (; *p && strchr("-+ #'0123456789.*", *p); p++) {
+            if (*p == '*')
+                trace_fmt_add_arg(fmt, TEGRA_TRACE_ARG_INT);
+        }
+
+        /* Length modifier, size_t and ptrdiff_t are long-sized.  */
+        for (lng = 0; *p && strchr("hlLqjzt", *p); p++) {
+            if (*p == 'l')
+                lng++;
+            else if (*p == 'z' || *p == 't')
+                lng = 1;
+            else if (*p != 'h')
+                lng = 2;
+        }
+
+        switch (*p) {
+        case '\0':
+            return;
+        case 's':
+            trace_fmt_add_arg(fmt, TEGRA_TRACE_ARG_STR);
+            break;
+        case 'p':
+            trace_fmt_add_arg(fmt, TEGRA_TRACE_ARG_PTR);
+            break;
+        case 'a': case 'A': case 'e': case 'E':
+        case 'f': case 'F': case 'g': case 'G':
+            trace_fmt_add_arg(fmt, TEGRA_TRACE_ARG_DOUBLE);
+            break;
+        default:
+            trace_fmt_add_arg(fmt, lng == 0 ? TEGRA_TRACE_ARG_INT :
+                                   lng == 1 ? TEGRA_TRACE_ARG_LONG :
+                                              TEGRA_TRACE_ARG_LLONG);
+        }
+        p++;
+    }
+}
+
+static struct trace_pkt_fmt *trace_fmt_pkt(uint32_t id, const char *text,
+                                            size_t *sz)
+{
+    struct trace_pkt_fmt *W;
+
+    *sz = sizeof(struct trace_pkt_fmt) + strlen(text) + 1;
+    W = g_malloc0(*sz);
+
+    W->magic = htonl(PACKET_TRACE_FMT);
+    W->id = htonl(id);
+    W->text_sz = htonl(strlen(text) + 1);
+    strcpy(W->text, text);
+
+    return W;
+}
+
+static int trace_fmt_send(int fd, uint32_t id, const char *text)
 {
-#ifdef _GNU_SOURCE
-    struct trace_pkt_txt *W;
-    va_list args;
-    char *txt;
     size_t sz;
+    struct trace_pkt_fmt *W = trace_fmt_pkt(id, text, &sz);
     int ret;
 
-    va_start(args, format);
-    ret = vasprintf(&txt, format, args);
-    va_end(args);
+    ret = tegra_send_all(fd, W, sz);
+    g_free(W);
 
-    if (ret < 1)
-        return;
+    return ret;
+}
 
-    sz = sizeof(*W) + strlen(txt);
-    W = malloc(sz);
-    W->magic = htonl(PACKET_TRACE_TXT);
-//     W->time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
-    W->text_sz = htonl(strlen(txt) + 1);
-    memcpy(W->text, txt, strlen(txt) + 1);
-    free(txt);
+/* Assign an ID to the format on its first use and announce it to the
+ * viewer, the recorder saves all the formats once recording is finished.  */
+static uint32_t tegra_trace_fmt_register(tegra_trace_fmt *fmt)
+{
+    struct trace_pkt_fmt *W;
+    uint32_t id;
+    size_t sz;
 
-    if (tegra_send_all(msgsock, W, sz) < 0) {
-        printf("%s", W->text);
+    qemu_mutex_lock(&fmt_mutex);
+
+    id = fmt->id;
+    if (id == 0) {
+        trace_fmt_parse(fmt);
+        g_ptr_array_add(trace_fmts, (gpointer) fmt->fmt);
+        id = trace_fmts->len;
+
+        W = trace_fmt_pkt(id, fmt->fmt, &sz);
+        tegra_trace_send(W, sz);
+        g_free(W);
+
+        qatomic_store_release(&fmt->id, id);
     }
 
-    free(W);
-#endif
+    qemu_mutex_unlock(&fmt_mutex);
+
+    return id;
+}
+
+const char *tegra_trace_fmt_get(uint32_t id)
+{
+    const char *fmt = NULL;
+
+    qemu_mutex_lock(&fmt_mutex);
+    if (id > 0 && id <= trace_fmts->len)
+        fmt = g_ptr_array_index(trace_fmts, id - 1);
+    qemu_mutex_unlock(&fmt_mutex);
+
+    return fmt;
+}
+
+/* Formatting is left to the viewer, only the format ID and raw arguments
+ * are traced.  */
+void tegra_trace_text_message(tegra_trace_fmt *fmt, ...)
+{
+    uint32_t id = qatomic_load_acquire(&fmt->id);
+    uint64_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+    uint32_t cpu_id = tegra_trace_cpu_id();
+    struct trace_pkt_txt W;
+    uint8_t *p = W.args;
+    uint8_t *end = W.args + sizeof(W.args);
+    union {
+        double d;
+        uint64_t u;
+    } dbl;
+    const char *str;
+    va_list args;
+    size_t len;
+    int i;
+
+    if (id == 0)
+        id = tegra_trace_fmt_register(fmt);
+
+    va_start(args, fmt);
+    for (i = 0; i < fmt->nargs; i++) {
+        if (end - p < 8)
+            break;
+
+        switch (fmt->args[i]) {
+        case TEGRA_TRACE_ARG_INT:
+            stl_be_p(p, va_arg(args, int));
+            p += 4;
+            break;
+        case TEGRA_TRACE_ARG_LONG:
+            stq_be_p(p, va_arg(args, long));
+            p += 8;
+            break;
+        case TEGRA_TRACE_ARG_LLONG:
+            stq_be_p(p, va_arg(args, long long));
+            p += 8;
+            break;
+        case TEGRA_TRACE_ARG_PTR:
+            stq_be_p(p, (uintptr_t) va_arg(args, void *));
+            p += 8;
+            break;
+        case TEGRA_TRACE_ARG_DOUBLE:
+            dbl.d = va_arg(args, double);
+            stq_be_p(p, dbl.u);
+            p += 8;
+            break;
+        case TEGRA_TRACE_ARG_STR:
+            str = va_arg(args, const char *);
+            if (!str)
+                str = "(null)";
+            len = strnlen(str, end - p - 4);
+            stl_be_p(p, len);
+            memcpy(p + 4, str, len);
+            p += 4 + len;
+            break;
+        }
+    }
+    va_end(args);
+
+    W.magic = htonl(PACKET_TRACE_TXT_V2);
+    W.id = htonl(id);
+    W.args_sz = htonl(p - W.args);
+    W.time = htonl(time);
+    W.cpu_id = htonl(cpu_id);
+    W.__pad0 = 0;
+    W.__pad1 = 0;
+
+    len = p - (uint8_t *) &W;
+
+    tegra_trace_record(&W, len, TEGRA_TRACE_NO_DEVICE, time, cpu_id);
+    tegra_trace_send(&W, len);
 }
 
 void tegra_trace_irq(uint32_t hwaddr, uint32_t hwirq, uint32_t status)
 {
-    uint32_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+    uint64_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+    uint32_t cpu_id = tegra_trace_cpu_id();
     struct trace_pkt_irq W = {
         htonl(PACKET_TRACE_IRQ),
         htonl(hwaddr),
@@ -193,10 +462,14 @@ void tegra_trace_irq(uint32_t hwaddr, uint32_t hwirq, uint32_t status)
         htonl(status),
         htonl(time),
         htonl(0),
-        htonl(0)
+        htonl(cpu_id)
     };
 
-    tegra_send_all(msgsock, &W, sizeof(W));
+    if (!(tegra_trace_dev_events(hwaddr) & TEGRA_TRACE_EV_IRQ))
+        return;
+
+    tegra_trace_record(&W, sizeof(W), hwaddr, time, cpu_id);
+    tegra_trace_send(&W, sizeof(W));
 }
 
 void tegra_trace_write(uint32_t hwaddr, uint32_t offset,
@@ -205,8 +478,8 @@ void tegra_trace_write(uint32_t hwaddr, uint32_t offset,
     CPUState *cs = CPU(current_cpu);
     ARMCPU *cpu = ARM_CPU(cs);
     uint32_t cpu_pc = cpu ? cpu->env.regs[15] : 0;
-    uint32_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
-    uint32_t cpu_id = host1x_cdma_ptr ? HOST1X_CDMA : (cs ? cs->cpu_index : 0xFF);
+    uint64_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+    uint32_t cpu_id = tegra_trace_cpu_id();
     struct trace_pkt_rw W = {
         htonl((is_write > 1) ? PACKET_TRACE_RW_V2 : PACKET_TRACE_RW),
         htonl(hwaddr),
@@ -219,12 +492,17 @@ void tegra_trace_write(uint32_t hwaddr, uint32_t offset,
         htonl(cpu_id)
     };
 
-    tegra_send_all(msgsock, &W, sizeof(W));
+    if (!(tegra_trace_dev_events(hwaddr) & TEGRA_TRACE_EV_RW))
+        return;
+
+    tegra_trace_record(&W, sizeof(W), hwaddr, time, cpu_id);
+    tegra_trace_send(&W, sizeof(W));
 }
 
 void tegra_trace_cdma(uint32_t data, uint32_t is_gather, uint32_t ch_id)
 {
-    uint32_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+    uint32_t hwaddr = TEGRA_GRHOST_BASE + ch_id * SZ_16K;
+    uint64_t time = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
     struct trace_pkt_cdma W = {
         htonl(PACKET_TRACE_CDMA),
         htonl(time),
@@ -233,33 +511,47 @@ void tegra_trace_cdma(uint32_t data, uint32_t is_gather, uint32_t ch_id)
         htonl(ch_id)
     };
 
-    tegra_send_all(msgsock, &W, sizeof(W));
+    if (!(tegra_trace_dev_events(hwaddr) & TEGRA_TRACE_EV_CDMA))
+        return;
+
+    tegra_trace_record(&W, sizeof(W), hwaddr, time, TEGRA_TRACE_CPU_CDMA);
+    tegra_trace_send(&W, sizeof(W));
 }
 
 #define CMD_CHANGE_TIMERS_FREQ      0x122
 
-#ifdef TEGRA_TRACE
 static void * trace_viewer_cmd_handler(void *arg)
 {
     tegra_timer_us **timer_us = (void *) &tegra_timer_us_dev;
     tegra_timer **timer3 = (void *) &tegra_timer3_dev;
     tegra_timer **timer2 = (void *) &tegra_timer2_dev;
+    unsigned int gen = 0;
     uint32_t freq;
     uint32_t cmd;
+    int fd = -1;
 
     for (;;) {
-        if (msgsock == -1 || tegra_recv_all(msgsock, &cmd, sizeof(cmd), 0) < sizeof(cmd)) {
+        /* Follow the viewer socket, see tegra_trace_send().  */
+        qemu_mutex_lock(&send_mutex);
+        if (gen != msgsock_gen) {
+            if (fd != -1)
+                close(fd);
+
+            fd = msgsock == -1 ? -1 : qemu_dup(msgsock);
+            gen = msgsock_gen;
+        }
+        qemu_mutex_unlock(&send_mutex);
+
+        if (fd == -1 || tegra_recv_all(fd, &cmd, sizeof(cmd), 0) < sizeof(cmd)) {
             sleep(1);
             continue;
         }
 
         switch (cmd) {
         case CMD_CHANGE_TIMERS_FREQ:
-            tegra_recv_all(msgsock, &freq, sizeof(freq), 0);
+            tegra_recv_all(fd, &freq, sizeof(freq), 0);
             /* Does't include ARM's MPtimer!  */
-            ptimer_transaction_begin((*timer_us)->ptimer);
-            ptimer_set_freq((*timer_us)->ptimer, freq);
-            ptimer_transaction_commit((*timer_us)->ptimer);
+            tegra_timer_us_set_freq(*timer_us, freq);
 
             ptimer_transaction_begin((*timer3)->ptimer);
             ptimer_set_freq((*timer3)->ptimer, freq);
@@ -278,45 +570,227 @@ static void * trace_viewer_cmd_handler(void *arg)
 
     return NULL;
 }
-#endif // TEGRA_TRACE
 
-void tegra_trace_init(void)
+static void trace_viewer_accept(void *opaque)
 {
-#ifdef TEGRA_TRACE
-    SocketAddress *saddr;
-    QemuThread trace_cmd_thread;
-    static int sock = -1;
+    int fd = qemu_accept(listen_sock, NULL, NULL);
+    int old_fd;
+    guint i;
 
-    if (msgsock != -1) {
-        close(msgsock);
-    }
+    if (fd == -1)
+        return;
 
-    if (sock != -1) {
-        goto WAIT;
+    /* New viewer needs all the formats that were announced so far.  */
+    qemu_mutex_lock(&fmt_mutex);
+
+    for (i = 0; i < trace_fmts->len; i++) {
+        if (trace_fmt_send(fd, i + 1, g_ptr_array_index(trace_fmts, i)) < 0) {
+            qemu_mutex_unlock(&fmt_mutex);
+            close(fd);
+            return;
+        }
     }
 
-    qemu_mutex_init(&send_mutex);
+    qemu_mutex_lock(&send_mutex);
+    old_fd = qatomic_xchg(&msgsock, fd);
+    if (old_fd != -1)
+        trace_viewer_close_locked(old_fd);
+    msgsock_gen++;
+    qemu_mutex_unlock(&send_mutex);
+
+    qemu_mutex_unlock(&fmt_mutex);
+
+    info_report("Tegra trace viewer connected");
+}
+
+/* Start listening for a trace viewer, the connection is accepted by the
+ * main loop so that emulation never waits for it.  */
+static bool tegra_trace_listen(Error **errp)
+{
+    SocketAddress *saddr;
+    QemuThread trace_cmd_thread;
+
+    if (listen_sock != -1)
+        return true;
 
 #ifdef LOCAL_SOCKET
-    saddr = socket_parse("unix:" SOCKET_FILE, &error_abort);
+    saddr = socket_parse("unix:" SOCKET_FILE, errp);
 #else
-    saddr = socket_parse("0.0.0.0:19191", &error_abort);
+    saddr = socket_parse("0.0.0.0:19191", errp);
 #endif // LOCAL_SOCKET
-
-    sock = socket_listen(saddr, 1, &error_abort);
-    socket_set_fast_reuse(sock);
-
-    if (listen(sock, 1) < 0) {
-        error_setg_errno(&error_abort, errno, "Failed to listen on socket");
+    if (!saddr)
+        return false;
+
+    listen_sock = socket_listen(saddr, 1, errp);
+    qapi_free_SocketAddress(saddr);
+    if (listen_sock < 0) {
+        listen_sock = -1;
+        return false;
     }
+    socket_set_fast_reuse(listen_sock);
+
+    qemu_set_fd_handler(listen_sock, trace_viewer_accept, NULL, NULL);
 
     qemu_thread_create(&trace_cmd_thread, "trace_cmd_handler",
                        trace_viewer_cmd_handler,
                        NULL, QEMU_THREAD_DETACHED);
 
-WAIT:
-    printf("Waiting for trace viewer connection...\n");
-    msgsock = qemu_accept(sock, NULL, NULL);
-    g_assert(msgsock != -1);
-#endif // TEGRA_TRACE
+    return true;
+}
+
+static void tegra_trace_update_dstate(void)
+{
+    GHashTableIter iter;
+    uint32_t dstate = trace_default_events;
+    gpointer val;
+
+    g_hash_table_iter_init(&iter, trace_dev_events);
+    while (g_hash_table_iter_next(&iter, NULL, &val)) {
+        dstate |= GPOINTER_TO_UINT(val);
+    }
+
+    qatomic_set(&tegra_trace_dstate, dstate);
+}
+
+void tegra_trace_set_events(bool has_device, uint32_t device,
+                            uint32_t events, bool enable, Error **errp)
+{
+    GHashTableIter iter;
+    uint32_t dev_events;
+    gpointer val;
+
+    if (enable && !tegra_trace_listen(errp))
+        return;
+
+    qemu_mutex_lock(&trace_mutex);
+
+    if (has_device) {
+        /* Text messages aren't bound to a device.  */
+        events &= ~TEGRA_TRACE_EV_TXT;
+
+        if (g_hash_table_lookup_extended(trace_dev_events,
+                                         GUINT_TO_POINTER(device), NULL, &val))
+            dev_events = GPOINTER_TO_UINT(val);
+        else
+            dev_events = trace_default_events;
+
+        dev_events = enable ? dev_events | events : dev_events & ~events;
+        g_hash_table_insert(trace_dev_events, GUINT_TO_POINTER(device),
+                            GUINT_TO_POINTER(dev_events));
+    } else {
+        if (enable)
+            trace_default_events |= events;
+        else
+            trace_default_events &= ~events;
+
+        g_hash_table_iter_init(&iter, trace_dev_events);
+        while (g_hash_table_iter_next(&iter, NULL, &val)) {
+            dev_events = GPOINTER_TO_UINT(val);
+            dev_events = enable ? dev_events | events : dev_events & ~events;
+            g_hash_table_iter_replace(&iter, GUINT_TO_POINTER(dev_events));
+        }
+    }
+
+    tegra_trace_update_dstate();
+
+    qemu_mutex_unlock(&trace_mutex);
+}
+
+void tegra_trace_init(void)
+{
+    qemu_mutex_init(&send_mutex);
+    qemu_mutex_init(&trace_mutex);
+    qemu_mutex_init(&fmt_mutex);
+
+    trace_dev_events = g_hash_table_new(NULL, NULL);
+    trace_fmts = g_ptr_array_new();
+
+    tegra_trace_record_init();
+}
+
+static TegraTraceEventList *tegra_trace_events_list(uint32_t events)
+{
+    TegraTraceEventList *list = NULL;
+    int ev;
+
+    for (ev = TEGRA_TRACE_EVENT__MAX - 1; ev >= 0; ev--) {
+        if (events & (1 << ev)) {
+            QAPI_LIST_PREPEND(list, ev);
+        }
+    }
+
+    return list;
+}
+
+void qmp_tegra_trace_set(TegraTraceEventList *events, bool enable,
+                         bool has_device, uint32_t device, Error **errp)
+{
+    TegraTraceEventList *ev;
+    uint32_t mask = 0;
+
+    if (!trace_dev_events) {
+        error_setg(errp, "Tegra tracing is not available on this machine");
+        return;
+    }
+
+    for (ev = events; ev; ev = ev->next) {
+        mask |= 1 << ev->value;
+    }
+
+    tegra_trace_set_events(has_device, device, mask, enable, errp);
+}
+
+void qmp_tegra_trace_record(bool enable, bool has_file, const char *file,
+                            Error **errp)
+{
+    if (!trace_dev_events) {
+        error_setg(errp, "Tegra tracing is not available on this machine");
+        return;
+    }
+
+    if (!enable) {
+        tegra_trace_record_stop();
+        return;
+    }
+
+    if (!has_file) {
+        error_setg(errp, "Parameter 'file' is required to start recording");
+        return;
+    }
+
+    tegra_trace_record_start(file, errp);
+}
+
+TegraTraceInfo *qmp_query_tegra_trace(Error **errp)
+{
+    TegraTraceInfo *info;
+    GHashTableIter iter;
+    gpointer key, val;
+
+    if (!trace_dev_events) {
+        error_setg(errp, "Tegra tracing is not available on this machine");
+        return NULL;
+    }
+
+    info = g_new0(TegraTraceInfo, 1);
+    info->connected = qatomic_read(&msgsock) != -1;
+    info->record_file = tegra_trace_record_path();
+    info->has_record_file = !!info->record_file;
+
+    qemu_mutex_lock(&trace_mutex);
+
+    info->events = tegra_trace_events_list(trace_default_events);
+
+    g_hash_table_iter_init(&iter, trace_dev_events);
+    while (g_hash_table_iter_next(&iter, &key, &val)) {
+        TegraTraceDeviceInfo *dev = g_new0(TegraTraceDeviceInfo, 1);
+
+        dev->device = GPOINTER_TO_UINT(key);
+        dev->events = tegra_trace_events_list(GPOINTER_TO_UINT(val));
+        QAPI_LIST_PREPEND(info->devices, dev);
+    }
+
+    qemu_mutex_unlock(&trace_mutex);
+
+    return info;
 }
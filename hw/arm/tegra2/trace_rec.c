@@ -0,0 +1,406 @@
+/*
+ * ARM NVIDIA Tegra2 emulation.
+ *
+ * Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Trace recorder.
+ *
+ * The file starts with a trace_file_hdr followed by fixed-size chunks, so
+ * chunk N lives at sizeof(hdr) + N * chunk_size and the whole file can be
+ * mmap'ed by the reader (scripts/tegra-trace.py).  Every chunk carries an
+ * index of its time range, CPUs and devices, which lets the reader skip
+ * chunks without touching the records.  All fields are big-endian, records
+ * are the same packets that are sent to the trace viewer.  Text packets
+ * occupy as many consecutive records as needed and never cross a chunk.
+ *
+ * TPRINT formats referenced by the text packets are written after the
+ * last chunk once recording is finished, hdr.fmt_offset points to them.
+ *
+ * Record times are the 32-bit microsecond times of the packets, the chunk
+ * index has the full 64-bit time range, so the reader can extend them.
+ *
+ * Full chunks are written out by a writer thread, traced threads only
+ * block if TRACE_CHUNK_QUEUE_MAX chunks are waiting for the disk.
+ */
+
+#include "tegra_common.h"
+
+#include "qapi/error.h"
+#include "qemu/bswap.h"
+#include "qemu/queue.h"
+#include "qemu/thread.h"
+
+#include "tegra_trace.h"
+
+#define TRACE_FILE_MAGIC        "TGRTRACE"
+#define TRACE_FILE_VERSION      3
+#define TRACE_CHUNK_MAGIC       0x54434853
+#define TRACE_CHUNK_RECORDS     16384
+#define TRACE_CHUNK_MAX_DEVICES 56
+#define TRACE_CHUNK_QUEUE_MAX   8
+#define TRACE_CHUNK_DEV_OVERFLOW 0xffffffff
+#define TRACE_FMT_MAGIC         0x54464d54
+
+/* CPU mask bits in chunk index */
+#define TRACE_CPU_CDMA          3
+#define TRACE_CPU_OTHER         4
+
+struct __attribute__((packed, aligned(1))) trace_file_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_hdr_size;
+    uint32_t record_size;
+    uint32_t chunk_records;
+    uint64_t fmt_offset;
+    uint8_t __pad[32];
+};
+
+struct __attribute__((packed, aligned(1))) trace_fmt_hdr {
+    uint32_t magic;
+    uint32_t nr_fmts;
+};
+
+struct __attribute__((packed, aligned(1))) trace_chunk_hdr {
+    uint32_t magic;
+    uint32_t nr_records;
+    uint64_t time_min;
+    uint64_t time_max;
+    uint32_t cpu_mask;
+    uint32_t nr_devices;
+    uint32_t devices[TRACE_CHUNK_MAX_DEVICES];
+};
+
+QEMU_BUILD_BUG_ON(sizeof(struct trace_file_hdr) != 64);
+QEMU_BUILD_BUG_ON(sizeof(struct trace_chunk_hdr) != 256);
+
+struct trace_chunk {
+    QSIMPLEQ_ENTRY(trace_chunk) next;
+    uint32_t nr_records;
+    uint64_t time_min;
+    uint64_t time_max;
+    uint32_t cpu_mask;
+    uint32_t nr_devices;
+    uint32_t devices[TRACE_CHUNK_MAX_DEVICES];
+    uint8_t records[TRACE_CHUNK_RECORDS][TEGRA_TRACE_REC_SIZE];
+};
+
+static QemuMutex rec_mutex;
+static struct trace_chunk *chunk;
+static char *rec_path;
+static int rec_fd = -1;
+
+/* Chunks handed to the writer, including the one being written.  */
+static QSIMPLEQ_HEAD(, trace_chunk) full_chunks =
+    QSIMPLEQ_HEAD_INITIALIZER(full_chunks);
+static QSIMPLEQ_HEAD(, trace_chunk) free_chunks =
+    QSIMPLEQ_HEAD_INITIALIZER(free_chunks);
+static unsigned int nr_full_chunks;
+static QemuCond rec_queued_cond;
+static QemuCond rec_written_cond;
+static QemuThread rec_thread;
+static bool rec_stopping;
+
+static void trace_chunk_reset(void)
+{
+    chunk->nr_records = 0;
+    chunk->time_min = UINT64_MAX;
+    chunk->time_max = 0;
+    chunk->cpu_mask = 0;
+    chunk->nr_devices = 0;
+}
+
+static void trace_chunk_add_device(uint32_t hwaddr)
+{
+    uint32_t lo = 0, hi = chunk->nr_devices;
+
+    if (chunk->nr_devices == TRACE_CHUNK_DEV_OVERFLOW)
+        return;
+
+    /* Keep the index sorted, chunks rarely touch more than a few devices.  */
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (chunk->devices[mid] == hwaddr)
+            return;
+
+        if (chunk->devices[mid] < hwaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (chunk->nr_devices == TRACE_CHUNK_MAX_DEVICES) {
+        chunk->nr_devices = TRACE_CHUNK_DEV_OVERFLOW;
+        return;
+    }
+
+    memmove(&chunk->devices[lo + 1], &chunk->devices[lo],
+            (chunk->nr_devices - lo) * sizeof(chunk->devices[0]));
+    chunk->devices[lo] = hwaddr;
+    chunk->nr_devices++;
+}
+
+/* Runs on the writer thread without rec_mutex.  */
+static void trace_chunk_write(int fd, struct trace_chunk *c)
+{
+    struct trace_chunk_hdr hdr = {
+        .magic = cpu_to_be32(TRACE_CHUNK_MAGIC),
+        .nr_records = cpu_to_be32(c->nr_records),
+        .time_min = cpu_to_be64(c->time_min),
+        .time_max = cpu_to_be64(c->time_max),
+        .cpu_mask = cpu_to_be32(c->cpu_mask),
+        .nr_devices = cpu_to_be32(c->nr_devices),
+    };
+    uint32_t i;
+
+    for (i = 0; i < c->nr_devices &&
+                            c->nr_devices != TRACE_CHUNK_DEV_OVERFLOW; i++)
+        hdr.devices[i] = cpu_to_be32(c->devices[i]);
+
+    /* Unused tail of the last chunk is zeroed to keep chunks fixed-size.  */
+    memset(c->records[c->nr_records], 0,
+           (TRACE_CHUNK_RECORDS - c->nr_records) * TEGRA_TRACE_REC_SIZE);
+
+    if (qemu_write_full(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        qemu_write_full(fd, c->records, sizeof(c->records)) !=
+                                                    sizeof(c->records)) {
+        fprintf(stderr, "%s: failed to write %s: %s\n",
+                __func__, rec_path, strerror(errno));
+    }
+}
+
+static void *trace_rec_writer(void *opaque)
+{
+    int fd = GPOINTER_TO_INT(opaque);
+    struct trace_chunk *c;
+
+    qemu_mutex_lock(&rec_mutex);
+
+    for (;;) {
+        while (QSIMPLEQ_EMPTY(&full_chunks) && !rec_stopping)
+            qemu_cond_wait(&rec_queued_cond, &rec_mutex);
+
+        c = QSIMPLEQ_FIRST(&full_chunks);
+        if (!c)
+            break;
+
+        qemu_mutex_unlock(&rec_mutex);
+        trace_chunk_write(fd, c);
+        qemu_mutex_lock(&rec_mutex);
+
+        QSIMPLEQ_REMOVE_HEAD(&full_chunks, next);
+        QSIMPLEQ_INSERT_HEAD(&free_chunks, c, next);
+        nr_full_chunks--;
+        qemu_cond_signal(&rec_written_cond);
+    }
+
+    qemu_mutex_unlock(&rec_mutex);
+
+    return NULL;
+}
+
+/* Hands the current chunk to the writer, caller must hold rec_mutex.  */
+static void trace_chunk_queue(void)
+{
+    if (chunk->nr_records == 0)
+        return;
+
+    while (nr_full_chunks >= TRACE_CHUNK_QUEUE_MAX)
+        qemu_cond_wait(&rec_written_cond, &rec_mutex);
+
+    QSIMPLEQ_INSERT_TAIL(&full_chunks, chunk, next);
+    nr_full_chunks++;
+    qemu_cond_signal(&rec_queued_cond);
+
+    chunk = QSIMPLEQ_FIRST(&free_chunks);
+    if (chunk)
+        QSIMPLEQ_REMOVE_HEAD(&free_chunks, next);
+    else
+        chunk = g_new(struct trace_chunk, 1);
+
+    trace_chunk_reset();
+}
+
+/* Write out the table of TPRINT formats and point the file header to it.  */
+static void trace_fmt_table_write(int fd)
+{
+    GByteArray *buf = g_byte_array_new();
+    struct trace_fmt_hdr hdr;
+    uint64_t fmt_offset;
+    const char *fmt;
+    uint32_t id, val;
+    off_t off;
+
+    for (id = 1; (fmt = tegra_trace_fmt_get(id)) != NULL; id++) {
+        val = cpu_to_be32(id);
+        g_byte_array_append(buf, (void *) &val, sizeof(val));
+        val = cpu_to_be32(strlen(fmt));
+        g_byte_array_append(buf, (void *) &val, sizeof(val));
+        g_byte_array_append(buf, (void *) fmt, strlen(fmt));
+    }
+
+    hdr.magic = cpu_to_be32(TRACE_FMT_MAGIC);
+    hdr.nr_fmts = cpu_to_be32(id - 1);
+
+    off = lseek(fd, 0, SEEK_CUR);
+    fmt_offset = cpu_to_be64(off);
+
+    if (off < 0 ||
+        qemu_write_full(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        qemu_write_full(fd, buf->data, buf->len) != buf->len ||
+        lseek(fd, offsetof(struct trace_file_hdr, fmt_offset),
+              SEEK_SET) < 0 ||
+        qemu_write_full(fd, &fmt_offset, sizeof(fmt_offset)) !=
+                                                    sizeof(fmt_offset)) {
+        fprintf(stderr, "%s: failed to write %s: %s\n",
+                __func__, rec_path, strerror(errno));
+    }
+
+    g_byte_array_free(buf, true);
+}
+
+void tegra_trace_record(const void *pkt, uint32_t len, uint32_t hwaddr,
+                        uint64_t time, uint32_t cpu_id)
+{
+    uint32_t nr = DIV_ROUND_UP(len, TEGRA_TRACE_REC_SIZE);
+    uint8_t *rec;
+
+    if (qatomic_read(&rec_fd) == -1)
+        return;
+
+    qemu_mutex_lock(&rec_mutex);
+
+    if (rec_fd == -1)
+        goto out;
+
+    if (chunk->nr_records + nr > TRACE_CHUNK_RECORDS)
+        trace_chunk_queue();
+
+    rec = chunk->records[chunk->nr_records];
+    memcpy(rec, pkt, len);
+    memset(rec + len, 0, nr * TEGRA_TRACE_REC_SIZE - len);
+    chunk->nr_records += nr;
+
+    chunk->time_min = MIN(chunk->time_min, time);
+    chunk->time_max = MAX(chunk->time_max, time);
+
+    if (cpu_id < TRACE_CPU_CDMA)
+        chunk->cpu_mask |= 1 << cpu_id;
+    else if (cpu_id == TEGRA_TRACE_CPU_CDMA)
+        chunk->cpu_mask |= 1 << TRACE_CPU_CDMA;
+    else
+        chunk->cpu_mask |= 1 << TRACE_CPU_OTHER;
+
+    if (hwaddr != TEGRA_TRACE_NO_DEVICE)
+        trace_chunk_add_device(hwaddr);
+
+    if (chunk->nr_records == TRACE_CHUNK_RECORDS)
+        trace_chunk_queue();
+out:
+    qemu_mutex_unlock(&rec_mutex);
+}
+
+void tegra_trace_record_start(const char *path, Error **errp)
+{
+    struct trace_file_hdr hdr = {
+        .magic = TRACE_FILE_MAGIC,
+        .version = cpu_to_be32(TRACE_FILE_VERSION),
+        .chunk_hdr_size = cpu_to_be32(sizeof(struct trace_chunk_hdr)),
+        .record_size = cpu_to_be32(TEGRA_TRACE_REC_SIZE),
+        .chunk_records = cpu_to_be32(TRACE_CHUNK_RECORDS),
+    };
+    int fd;
+
+    tegra_trace_record_stop();
+
+    fd = qemu_open_old(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0) {
+        error_setg_errno(errp, errno, "failed to open '%s'", path);
+        return;
+    }
+
+    if (qemu_write_full(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        error_setg_errno(errp, errno, "failed to write '%s'", path);
+        close(fd);
+        return;
+    }
+
+    qemu_mutex_lock(&rec_mutex);
+
+    if (!chunk)
+        chunk = g_new(struct trace_chunk, 1);
+
+    trace_chunk_reset();
+    rec_path = g_strdup(path);
+    qatomic_set(&rec_fd, fd);
+
+    qemu_thread_create(&rec_thread, "tegra_trace_rec", trace_rec_writer,
+                       GINT_TO_POINTER(fd), QEMU_THREAD_JOINABLE);
+
+    qemu_mutex_unlock(&rec_mutex);
+}
+
+void tegra_trace_record_stop(void)
+{
+    int fd;
+
+    qemu_mutex_lock(&rec_mutex);
+
+    fd = rec_fd;
+    if (fd == -1) {
+        qemu_mutex_unlock(&rec_mutex);
+        return;
+    }
+
+    qatomic_set(&rec_fd, -1);
+    trace_chunk_queue();
+    rec_stopping = true;
+    qemu_cond_signal(&rec_queued_cond);
+
+    qemu_mutex_unlock(&rec_mutex);
+
+    /* Waits for the queued chunks to be written.  */
+    qemu_thread_join(&rec_thread);
+
+    trace_fmt_table_write(fd);
+    close(fd);
+
+    qemu_mutex_lock(&rec_mutex);
+    rec_stopping = false;
+    g_free(rec_path);
+    rec_path = NULL;
+    qemu_mutex_unlock(&rec_mutex);
+}
+
+char *tegra_trace_record_path(void)
+{
+    char *path;
+
+    qemu_mutex_lock(&rec_mutex);
+    path = g_strdup(rec_path);
+    qemu_mutex_unlock(&rec_mutex);
+
+    return path;
+}
+
+void tegra_trace_record_init(void)
+{
+    qemu_mutex_init(&rec_mutex);
+    qemu_cond_init(&rec_queued_cond);
+    qemu_cond_init(&rec_written_cond);
+}
@@ -414,6 +414,7 @@ static void gic_set_irq(void *opaque, int irq, int level)
     } else {
         gic_set_irq_generic(s, irq, level, cm, target);
     }
+    gic_update_spi_pending(s, irq);
     trace_gic_set_irq(irq, level, cm, target);
 
     gic_update(s);
@@ -917,6 +918,7 @@ static void gic_complete_irq(GICState *s, int cpu, int irq, MemTxAttrs attrs)
             && (GIC_DIST_TARGET(irq) & cm) != 0) {
             DPRINTF("Set %d pending mask %x\n", irq, cm);
             GIC_DIST_SET_PENDING(irq, cm);
+            gic_update_spi_pending(s, irq);
         }
     }
 
@@ -1256,6 +1258,7 @@ static void gic_dist_writeb(void *opaque, hwaddr offset,
                     DPRINTF("Set %d pending mask %x\n", irq + i, mask);
                     GIC_DIST_SET_PENDING(irq + i, mask);
                 }
+                gic_update_spi_pending(s, irq + i);
             }
         }
     } else if (offset < 0x200) {
@@ -1281,6 +1284,7 @@ static void gic_dist_writeb(void *opaque, hwaddr offset,
                     trace_gic_disable_irq(irq + i);
                 }
                 GIC_DIST_CLEAR_ENABLED(irq + i, cm);
+                gic_update_spi_pending(s, irq + i);
             }
         }
     } else if (offset < 0x280) {
@@ -1300,6 +1304,7 @@ static void gic_dist_writeb(void *opaque, hwaddr offset,
                 }
 
                 GIC_DIST_SET_PENDING(irq + i, GIC_DIST_TARGET(irq + i));
+                gic_update_spi_pending(s, irq + i);
             }
         }
     } else if (offset < 0x300) {
@@ -1322,6 +1327,7 @@ static void gic_dist_writeb(void *opaque, hwaddr offset,
                corect behavior.  */
             if (value & (1 << i)) {
                 GIC_DIST_CLEAR_PENDING(irq + i, ALL_CPU_MASK);
+                gic_update_spi_pending(s, irq + i);
             }
         }
     } else if (offset < 0x380) {
@@ -1419,6 +1425,7 @@ static void gic_dist_writeb(void *opaque, hwaddr offset,
             } else {
                 GIC_DIST_CLEAR_EDGE_TRIGGER(irq + i);
             }
+            gic_update_spi_pending(s, irq + i);
         }
     } else if (offset < 0xf10) {
         /* 0xf00 is only handled for 32-bit writes.  */
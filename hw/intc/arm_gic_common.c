@@ -43,6 +43,8 @@ static int gic_post_load(void *opaque, int version_id)
     GICState *s = (GICState *)opaque;
     ARMGICCommonClass *c = ARM_GIC_COMMON_GET_CLASS(s);
 
+    gic_rebuild_spi_pending(s);
+
     if (c->post_load) {
         c->post_load(s);
     }
@@ -281,6 +283,8 @@ static void arm_gic_common_reset(DeviceState *dev)
     }
 
     memset(s->irq_state, 0, GIC_MAXIRQ * sizeof(gic_irq_state));
+    memset(s->spi_pending, 0, sizeof(s->spi_pending));
+    memset(s->spi_pending_nr, 0, sizeof(s->spi_pending_nr));
     arm_gic_common_reset_irq_state(s, 0, resetprio);
 
     if (s->virt_extn) {
@@ -178,6 +178,53 @@ static inline bool gic_test_pending(GICState *s, int irq, int cm)
     }
 }
 
+/* Updates the pending and enabled SPI summary of the IRQ.  */
+static inline void gic_update_spi_pending(GICState *s, int irq)
+{
+    uint32_t bit = 1U << (irq % 32);
+    int cpu;
+
+    if (irq < GIC_INTERNAL) {
+        return;
+    }
+
+    for (cpu = 0; cpu < s->num_cpu; cpu++) {
+        uint32_t *word = &s->spi_pending[cpu][irq / 32];
+        bool pending = GIC_DIST_TEST_ENABLED(irq, 1 << cpu) &&
+                       gic_test_pending(s, irq, 1 << cpu);
+
+        if (pending == !!(*word & bit)) {
+            continue;
+        }
+
+        if (pending) {
+            *word |= bit;
+            s->spi_pending_nr[cpu]++;
+        } else {
+            *word &= ~bit;
+            s->spi_pending_nr[cpu]--;
+        }
+    }
+}
+
+static inline void gic_rebuild_spi_pending(GICState *s)
+{
+    int irq;
+
+    memset(s->spi_pending, 0, sizeof(s->spi_pending));
+    memset(s->spi_pending_nr, 0, sizeof(s->spi_pending_nr));
+
+    for (irq = GIC_INTERNAL; irq < s->num_irq; irq++) {
+        gic_update_spi_pending(s, irq);
+    }
+}
+
+/* True if some SPI is pending and enabled for the CPU.  */
+static inline bool gic_cpu_has_spi_pending(GICState *s, int cpu)
+{
+    return s->spi_pending_nr[cpu] != 0;
+}
+
 static inline bool gic_is_vcpu(int cpu)
 {
     return cpu >= GIC_NCPU;
@@ -265,6 +312,7 @@ static inline void gic_clear_pending(GICState *s, int irq, int cpu)
          */
         GIC_DIST_CLEAR_PENDING(irq, GIC_DIST_TEST_MODEL(irq) ? ALL_CPU_MASK
                                                              : (1 << cpu));
+        gic_update_spi_pending(s, irq);
     }
 }
 
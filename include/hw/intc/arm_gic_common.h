@@ -99,6 +99,14 @@ struct GICState {
     uint16_t current_pending[GIC_NCPU_VCPU];
     uint32_t n_prio_bits;
 
+    /* Per-CPU bitmap and count of the SPIs that are both pending and
+     * enabled, kept up to date by gic_update_spi_pending() so that
+     * "is anything pending for this CPU" doesn't need a scan. Derived
+     * state, rebuilt on reset and migration.
+     */
+    uint32_t spi_pending[GIC_NCPU][GIC_MAXIRQ / 32];
+    uint16_t spi_pending_nr[GIC_NCPU];
+
     /* If we present the GICv2 without security extensions to a guest,
      * the guest can configure the GICC_CTLR to configure group 1 binary point
      * in the abpr.
@@ -49,5 +49,11 @@ void hmp_info_tlb(Monitor *mon, const QDict *qdict);
 void hmp_mce(Monitor *mon, const QDict *qdict);
 void hmp_info_local_apic(Monitor *mon, const QDict *qdict);
 void hmp_info_io_apic(Monitor *mon, const QDict *qdict);
+void hmp_tegra_trace_set(Monitor *mon, const QDict *qdict);
+void hmp_tegra_trace_record(Monitor *mon, const QDict *qdict);
+void hmp_info_tegra_trace(Monitor *mon, const QDict *qdict);
+void hmp_info_tegra_mmio(Monitor *mon, const QDict *qdict);
+void hmp_info_tegra_cdma(Monitor *mon, const QDict *qdict);
+void hmp_info_tegra_cpu_idle(Monitor *mon, const QDict *qdict);
 
 #endif /* MONITOR_HMP_TARGET_H */
@@ -81,6 +81,9 @@ int64_t cpu_get_ticks(void);
  */
 int64_t cpu_get_clock(void);
 
+/* Caller must hold BQL */
+void cpu_clock_warp(int64_t delta);
+
 void qemu_timer_notify_cb(void *opaque, QEMUClockType type);
 
 /* get the VIRTUAL clock and VM elapsed ticks via the cpus accel interface */
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+#
+# Query Tegra trace files recorded with the tegra-trace-record command
+#
+# Copyright (c) 2014-2015 Dmitry Osipenko <digetx@gmail.com>
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or later.
+# See the COPYING file in the top-level directory.
+#
+# The file is mmap'ed and every chunk is filtered by its index first, so
+# only the chunks that may contain matching records are decoded.  See
+# hw/arm/tegra2/trace_rec.c for the format.
+
+import argparse
+import mmap
+import re
+import struct
+import sys
+
+FILE_MAGIC = b'TGRTRACE'
+FILE_VERSION = 3
+FILE_HDR_FMT = '>8sIIIIQ32x'
+CHUNK_MAGIC = 0x54434853
+CHUNK_HDR_FMT = '>IIQQII'
+CHUNK_DEV_OVERFLOW = 0xffffffff
+FMT_MAGIC = 0x54464d54
+
+PACKET_TRACE_RW = 0x11111111
+PACKET_TRACE_RW_V2 = 0x11111112
+PACKET_TRACE_IRQ = 0x22223333
+PACKET_TRACE_TXT = 0x33336666
+PACKET_TRACE_CDMA = 0x44445555
+
+CPU_CDMA = 0x1010
+CPU_MASK_CDMA = 3
+CPU_MASK_OTHER = 4
+
+GRHOST_BASE = 0x50000000
+GRHOST_CH_SIZE = 0x4000
+
+NO_DEVICE = 0xffffffff
+
+# printf conversion, as parsed by trace_fmt_parse() in hw/arm/tegra2/trace.c
+CONV_RE = re.compile(r"%([-+ #'0-9.*]*)([hlLqjzt]*)([a-zA-Z%])")
+
+
+def cpu_mask_bit(cpu):
+    if cpu < CPU_MASK_CDMA:
+        return 1 << cpu
+    if cpu == CPU_CDMA:
+        return 1 << CPU_MASK_CDMA
+    return 1 << CPU_MASK_OTHER
+
+
+class Args:
+    """Raw TPRINT arguments of a text record"""
+
+    def __init__(self, buf):
+        self.buf = buf
+        self.pos = 0
+
+    def left(self):
+        return len(self.buf) - self.pos
+
+    def take(self, size):
+        val = self.buf[self.pos:self.pos + size]
+        self.pos += size
+        return val
+
+    def int(self, size, signed=False):
+        return int.from_bytes(self.take(size), 'big', signed=signed)
+
+
+def format_text(fmt, buf):
+    """Render a TPRINT format with the raw arguments of a text record"""
+    args = Args(buf)
+
+    def conv(m):
+        flags, length, spec = m.groups()
+
+        if spec == '%':
+            return '%'
+        if args.left() <= 0:
+            return '?'
+
+        # Width and precision passed as arguments
+        parts = flags.replace("'", '').split('*')
+        flags = ''.join(p + str(args.int(4, True)) for p in parts[:-1])
+        flags += parts[-1]
+
+        if spec == 's':
+            val = args.take(args.int(4)).decode(errors='replace')
+        elif spec in 'aAeEfFgG':
+            val, = struct.unpack('>d', args.take(8))
+            spec = 'e' if spec in 'aA' else spec
+        elif spec == 'p':
+            val = args.int(8)
+            flags, spec = '#' + flags, 'x'
+        else:
+            wide = length not in ('', 'h', 'hh')
+            val = args.int(8 if wide else 4, spec in 'di')
+            spec = 'd' if spec in 'diu' else spec
+
+        return ('%' + flags + spec) % val
+
+    return CONV_RE.sub(conv, fmt)
+
+
+class Record:
+    def __init__(self, buf, fmts, time_base):
+        magic, = struct.unpack_from('>I', buf)
+        self.magic = magic
+        self.device = NO_DEVICE
+
+        if magic in (PACKET_TRACE_RW, PACKET_TRACE_RW_V2):
+            (_, self.device, self.offset, self.value, self.new_value,
+             self.is_write, self.time, self.pc,
+             self.cpu) = struct.unpack_from('>9I', buf)
+        elif magic == PACKET_TRACE_IRQ:
+            (_, self.device, self.irq, self.status, self.time,
+             self.pc, self.cpu) = struct.unpack_from('>7I', buf)
+        elif magic == PACKET_TRACE_CDMA:
+            (_, self.time, self.data, self.is_gather,
+             self.ch_id) = struct.unpack_from('>5I', buf)
+            self.device = GRHOST_BASE + self.ch_id * GRHOST_CH_SIZE
+            self.cpu = CPU_CDMA
+        elif magic == PACKET_TRACE_TXT:
+            (_, self.fmt_id, args_sz, self.time,
+             self.cpu) = struct.unpack_from('>5I', buf)
+            self.args = buf[36:36 + args_sz]
+            self.fmt = fmts.get(self.fmt_id)
+        else:
+            raise ValueError('unknown record magic 0x%08x' % magic)
+
+        # Packet times are 32-bit, extend them from the chunk time range
+        time = (time_base & ~0xffffffff) | self.time
+        if time < time_base:
+            time += 1 << 32
+        self.time = time
+
+    @staticmethod
+    def size(buf, rec_size):
+        """Number of records occupied by the packet starting in buf"""
+        magic, = struct.unpack_from('>I', buf)
+        if magic != PACKET_TRACE_TXT:
+            return 1
+        args_sz, = struct.unpack_from('>I', buf, 8)
+        return (36 + args_sz + rec_size - 1) // rec_size
+
+    def __str__(self):
+        cpu = 'cdma' if self.cpu == CPU_CDMA else 'cpu%d' % self.cpu
+
+        if self.magic == PACKET_TRACE_TXT:
+            if self.fmt is None:
+                text = 'fmt#%u %s' % (self.fmt_id, self.args.hex())
+            else:
+                text = format_text(self.fmt, self.args).rstrip('\n')
+            return '%10u %-5s text  %s' % (self.time, cpu, text)
+
+        if self.magic == PACKET_TRACE_IRQ:
+            return '%10u %-5s irq   0x%08x irq=%u %s' % (
+                self.time, cpu, self.device, self.irq,
+                'raise' if self.status else 'lower')
+
+        if self.magic == PACKET_TRACE_CDMA:
+            return '%10u %-5s cdma  ch%u 0x%08x%s' % (
+                self.time, cpu, self.ch_id, self.data,
+                ' gather' if self.is_gather else '')
+
+        if self.is_write & 1:
+            return '%10u %-5s write 0x%08x+0x%03x 0x%08x -> 0x%08x pc=0x%08x' % (
+                self.time, cpu, self.device, self.offset, self.value,
+                self.new_value, self.pc)
+
+        return '%10u %-5s read  0x%08x+0x%03x 0x%08x pc=0x%08x' % (
+            self.time, cpu, self.device, self.offset, self.value, self.pc)
+
+
+class TraceFile:
+    def __init__(self, path):
+        self.fobj = open(path, 'rb')
+        self.map = mmap.mmap(self.fobj.fileno(), 0, access=mmap.ACCESS_READ)
+
+        hdr_size = struct.calcsize(FILE_HDR_FMT)
+        (magic, version, self.chunk_hdr_size, self.record_size,
+         self.chunk_records, fmt_offset) = struct.unpack_from(FILE_HDR_FMT,
+                                                              self.map)
+
+        if magic != FILE_MAGIC or version != FILE_VERSION:
+            raise ValueError('%s is not a Tegra trace file' % path)
+
+        # Formats are missing if QEMU didn't finish the recording
+        end = fmt_offset if fmt_offset else len(self.map)
+        self.fmts = self.read_fmts(fmt_offset) if fmt_offset else {}
+
+        self.data_offset = hdr_size
+        self.chunk_size = (self.chunk_hdr_size +
+                           self.chunk_records * self.record_size)
+        self.nr_chunks = (end - hdr_size) // self.chunk_size
+
+    def read_fmts(self, off):
+        magic, nr_fmts = struct.unpack_from('>II', self.map, off)
+        if magic != FMT_MAGIC:
+            raise ValueError('corrupted format table')
+
+        fmts = {}
+        off += 8
+        for _ in range(nr_fmts):
+            fmt_id, size = struct.unpack_from('>II', self.map, off)
+            fmts[fmt_id] = self.map[off + 8:off + 8 + size].decode(
+                errors='replace')
+            off += 8 + size
+
+        return fmts
+
+    def chunks(self):
+        for i in range(self.nr_chunks):
+            off = self.data_offset + i * self.chunk_size
+            (magic, nr_records, time_min, time_max, cpu_mask,
+             nr_devices) = struct.unpack_from(CHUNK_HDR_FMT, self.map, off)
+
+            if magic != CHUNK_MAGIC:
+                raise ValueError('corrupted chunk %d' % i)
+
+            if nr_devices == CHUNK_DEV_OVERFLOW:
+                devices = None
+            else:
+                devices = struct.unpack_from('>%dI' % nr_devices, self.map,
+                                             off + struct.calcsize(CHUNK_HDR_FMT))
+
+            yield (off + self.chunk_hdr_size, nr_records, time_min, time_max,
+                   cpu_mask, devices)
+
+    def query(self, device=None, time_from=None, time_to=None, cpu=None):
+        for (off, nr_records, time_min, time_max,
+             cpu_mask, devices) in self.chunks():
+            if time_from is not None and time_max < time_from:
+                continue
+            if time_to is not None and time_min > time_to:
+                continue
+            if cpu is not None and not cpu_mask & cpu_mask_bit(cpu):
+                continue
+            if device is not None and devices is not None and \
+                    device not in devices:
+                continue
+
+            i = 0
+            while i < nr_records:
+                rec_off = off + i * self.record_size
+                nr = Record.size(self.map[rec_off:rec_off + 12],
+                                 self.record_size)
+                rec = Record(self.map[rec_off:rec_off + nr * self.record_size],
+                             self.fmts, time_min)
+                i += nr
+
+                if time_from is not None and rec.time < time_from:
+                    continue
+                if time_to is not None and rec.time > time_to:
+                    continue
+                if cpu is not None and rec.cpu != cpu:
+                    continue
+                if device is not None and rec.device != device:
+                    continue
+
+                yield rec
+
+
+def parse_cpu(arg):
+    if arg == 'cdma':
+        return CPU_CDMA
+    return int(arg, 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Query a Tegra trace file')
+    parser.add_argument('file', help='trace file')
+    parser.add_argument('-d', '--device', type=lambda x: int(x, 0),
+                        help='device base address')
+    parser.add_argument('-f', '--from', dest='time_from', type=int,
+                        help='start time in microseconds')
+    parser.add_argument('-t', '--to', dest='time_to', type=int,
+                        help='end time in microseconds')
+    parser.add_argument('-c', '--cpu', type=parse_cpu,
+                        help='CPU index or "cdma"')
+    args = parser.parse_args()
+
+    trace = TraceFile(args.file)
+
+    try:
+        for rec in trace.query(args.device, args.time_from, args.time_to,
+                               args.cpu):
+            print(rec)
+    except BrokenPipeError:
+        pass
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
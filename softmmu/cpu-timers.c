@@ -137,6 +137,24 @@ void cpu_disable_ticks(void)
                          &timers_state.vm_clock_lock);
 }
 
+/*
+ * Advance the VIRTUAL clock by delta nanoseconds, used to skip over idle
+ * periods.  Not applicable to icount, which has its own warping.
+ * Caller must hold BQL which serves as mutex for vm_clock_seqlock.
+ */
+void cpu_clock_warp(int64_t delta)
+{
+    assert(!icount_enabled());
+
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    timers_state.cpu_clock_offset += delta;
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+}
+
 static bool icount_state_needed(void *opaque)
 {
     return icount_enabled();
@@ -1003,7 +1003,7 @@ struct ARMCPU {
     /* Used to synchronize KVM and QEMU in-kernel device levels */
     uint8_t device_irq_level;
 
-    hwaddr (*translate_addr)(hwaddr addr, int access_type);
+    hwaddr (*translate_addr)(hwaddr addr, int access_type, int *prot);
 
     /* Used to set the maximum vector length the cpu will support.  */
     uint32_t sve_max_vq;
@@ -12792,11 +12792,11 @@ bool get_phys_addr(CPUARMState *env, target_ulong address,
             }
         }
         ARMCPU *cpu = env_archcpu(env);
+        *prot = PAGE_READ | PAGE_WRITE | PAGE_EXEC;
         if (cpu->translate_addr) {
-            address = cpu->translate_addr(address, access_type);
+            address = cpu->translate_addr(address, access_type, prot);
         }
         *phys_ptr = address;
-        *prot = PAGE_READ | PAGE_WRITE | PAGE_EXEC;
         *page_size = TARGET_PAGE_SIZE;
 
         /* Fill in cacheattr a-la AArch64.TranslateAddressS1Off. */
@@ -306,6 +306,12 @@ vaddr arm_adjust_watchpoint_address(CPUState *cs, vaddr addr, int len);
 /* Callback function for when a watchpoint or breakpoint triggers. */
 void arm_debug_excp_handler(CPUState *cs);
 
+/*
+ * Called by WFI once the CPU is marked halted, before it goes to sleep.
+ * Boards may override the empty default.
+ */
+void arm_cpu_wfi_sleep(CPUState *cs);
+
 #if defined(CONFIG_USER_ONLY) || !defined(CONFIG_TCG)
 static inline bool arm_is_psci_call(ARMCPU *cpu, int excp_type)
 {
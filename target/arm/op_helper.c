@@ -317,10 +317,15 @@ void HELPER(wfi)(CPUARMState *env, uint32_t insn_len)
 
     cs->exception_index = EXCP_HLT;
     cs->halted = 1;
+    arm_cpu_wfi_sleep(cs);
     cpu_loop_exit(cs);
 #endif
 }
 
+void __attribute__((weak)) arm_cpu_wfi_sleep(CPUState *cs)
+{
+}
+
 void __attribute__((weak)) HELPER(wfe)(CPUARMState *env)
 {
     /* This is a hint instruction that is semantically different
@@ -333,6 +338,11 @@ void __attribute__((weak)) HELPER(wfe)(CPUARMState *env)
     HELPER(yield)(env);
 }
 
+void __attribute__((weak)) HELPER(sev)(CPUARMState *env)
+{
+    /* WFE never sleeps, so there is nobody to wake up. */
+}
+
 void HELPER(yield)(CPUARMState *env)
 {
     CPUState *cs = env_cpu(env);
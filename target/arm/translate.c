@@ -6262,6 +6262,13 @@ static bool trans_WFE(DisasContext *s, arg_WFE *a)
     return true;
 }
 
+static bool trans_SEV(DisasContext *s, arg_SEV *a)
+{
+    /* Only boards that let WFE sleep need the event, see HELPER(sev). */
+    gen_helper_sev(cpu_env);
+    return true;
+}
+
 static bool trans_WFI(DisasContext *s, arg_WFI *a)
 {
     /* For WFI, halt the vCPU until an IRQ. */